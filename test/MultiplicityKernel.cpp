@@ -0,0 +1,229 @@
+//
+//  MultiplicityKernel.cpp
+//  ProbabilisticRejection
+//
+//  Block kernels for the geometric multiplicity loop of PartitionCreator::createPartitionGroups().
+//
+
+#include "MultiplicityKernel.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MULTIPLICITY_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+
+//largest multiplicity an int holds. Quotients beyond it, from a uniform near 0 or log_y near 0, are clamped to it
+//rather than converted out of range.
+static const double multiplicity_limit = INT_MAX;
+
+
+void geometricMultiplicitiesScalar(const double* uniforms, int count, long long first_index, int stride, double log_y, int* out) {
+    for (int t = 0; t < count; ++t)
+    {
+        double i = first_index + (double)t*stride;
+        out[t] = (int)std::min(floor(log(uniforms[t])/(log_y*i)), multiplicity_limit);
+    }
+}
+
+
+#ifdef MULTIPLICITY_KERNEL_X86
+
+//coefficients of the fdlibm log, which is accurate to within one ulp
+static const double Lg1 = 6.666666666666735130e-01;
+static const double Lg2 = 3.999999999940941908e-01;
+static const double Lg3 = 2.857142874366239149e-01;
+static const double Lg4 = 2.222219843214978396e-01;
+static const double Lg5 = 1.818357216161805012e-01;
+static const double Lg6 = 1.531383769920937332e-01;
+static const double Lg7 = 1.479819860511658591e-01;
+static const double ln2_hi = 6.93147180369123816490e-01;
+static const double ln2_lo = 1.90821492927058770002e-10;
+
+//any lane whose quotient is closer than this relative distance to an integer is redone with the scalar log.
+//the polynomial log and the division together are off by a few ulp at most, far below this.
+static const double boundary_tolerance = 1e-13;
+
+
+__attribute__((target("avx2,fma")))
+static void geometricMultiplicitiesAVX2(const double* uniforms, int count, long long first_index, int stride, double log_y, int* out) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d sqrt2 = _mm256_set1_pd(1.4142135623730951);
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    const __m256i two52_bits = _mm256_set1_epi64x(0x4330000000000000LL);
+    const __m256i mantissa_mask = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m256i one_bits = _mm256_set1_epi64x(0x3FF0000000000000LL);
+    const __m256d tolerance = _mm256_set1_pd(boundary_tolerance);
+    const __m256d smallest_normal = _mm256_set1_pd(2.2250738585072014e-308);
+    const __m256d log_y_v = _mm256_set1_pd(log_y);
+    const __m256d limit = _mm256_set1_pd(multiplicity_limit);
+    const __m256d lane_offsets = _mm256_set_pd(3.0*stride, 2.0*stride, 1.0*stride, 0.0);
+    const __m256d step = _mm256_set1_pd(4.0*stride);
+
+    __m256d index = _mm256_add_pd(_mm256_set1_pd((double)first_index), lane_offsets);
+
+    int t = 0;
+    for (; t + 4 <= count; t += 4, index = _mm256_add_pd(index, step))
+    {
+        __m256d x = _mm256_loadu_pd(uniforms + t);
+        __m256i bits = _mm256_castpd_si256(x);
+
+        //split x into 2^k * m with m in [1,2), then move m into [sqrt(2)/2, sqrt(2))
+        __m256i exponent_bits = _mm256_or_si256(_mm256_srli_epi64(bits, 52), two52_bits);
+        __m256d k = _mm256_sub_pd(_mm256_sub_pd(_mm256_castsi256_pd(exponent_bits), two52), _mm256_set1_pd(1023.0));
+        __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantissa_mask), one_bits));
+        __m256d big = _mm256_cmp_pd(m, sqrt2, _CMP_GT_OQ);
+        m = _mm256_blendv_pd(m, _mm256_mul_pd(m, half), big);
+        k = _mm256_add_pd(k, _mm256_and_pd(big, one));
+
+        //log(1+f) = f - (hfsq - s*(hfsq+R)), as in fdlibm
+        __m256d f = _mm256_sub_pd(m, one);
+        __m256d s = _mm256_div_pd(f, _mm256_add_pd(f, _mm256_set1_pd(2.0)));
+        __m256d z = _mm256_mul_pd(s, s);
+        __m256d w = _mm256_mul_pd(z, z);
+        __m256d t1 = _mm256_fmadd_pd(w, _mm256_set1_pd(Lg6), _mm256_set1_pd(Lg4));
+        t1 = _mm256_fmadd_pd(w, t1, _mm256_set1_pd(Lg2));
+        t1 = _mm256_mul_pd(w, t1);
+        __m256d t2 = _mm256_fmadd_pd(w, _mm256_set1_pd(Lg7), _mm256_set1_pd(Lg5));
+        t2 = _mm256_fmadd_pd(w, t2, _mm256_set1_pd(Lg3));
+        t2 = _mm256_fmadd_pd(w, t2, _mm256_set1_pd(Lg1));
+        t2 = _mm256_mul_pd(z, t2);
+        __m256d R = _mm256_add_pd(t1, t2);
+        __m256d hfsq = _mm256_mul_pd(half, _mm256_mul_pd(f, f));
+        __m256d inner = _mm256_fmadd_pd(s, _mm256_add_pd(hfsq, R), _mm256_mul_pd(k, _mm256_set1_pd(ln2_lo)));
+        __m256d log_x = _mm256_sub_pd(_mm256_mul_pd(k, _mm256_set1_pd(ln2_hi)), _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+
+        __m256d q = _mm256_div_pd(log_x, _mm256_mul_pd(log_y_v, index));
+        __m256d floor_q = _mm256_floor_pd(q);
+        _mm_storeu_si128((__m128i*)(out + t), _mm256_cvttpd_epi32(_mm256_min_pd(floor_q, limit)));
+
+        //lanes too close to an integer boundary, or with inputs the bit tricks above do not cover, use the scalar log
+        __m256d margin = _mm256_mul_pd(tolerance, _mm256_add_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), q), one));
+        __m256d unsure = _mm256_or_pd(_mm256_cmp_pd(_mm256_floor_pd(_mm256_sub_pd(q, margin)), floor_q, _CMP_NEQ_UQ),
+                                      _mm256_cmp_pd(_mm256_floor_pd(_mm256_add_pd(q, margin)), floor_q, _CMP_NEQ_UQ));
+        unsure = _mm256_or_pd(unsure, _mm256_cmp_pd(x, smallest_normal, _CMP_NGE_UQ));
+        int redo = _mm256_movemask_pd(unsure);
+        for (int lane = 0; redo != 0; ++lane, redo >>= 1)
+            if (redo & 1)
+                geometricMultiplicitiesScalar(uniforms + t + lane, 1, first_index + (t + lane)*stride, stride, log_y, out + t + lane);
+    }
+
+    if (t < count)
+        geometricMultiplicitiesScalar(uniforms + t, count - t, first_index + t*stride, stride, log_y, out + t);
+}
+
+
+//the maskz forms with every lane selected are used where the plain intrinsics start from an undefined vector, which
+//GCC reports as possibly uninitialized under -Wall. Their results are the same.
+__attribute__((target("avx512f")))
+static void geometricMultiplicitiesAVX512(const double* uniforms, int count, long long first_index, int stride, double log_y, int* out) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d sqrt2 = _mm512_set1_pd(1.4142135623730951);
+    const __m512d two52 = _mm512_set1_pd(4503599627370496.0);
+    const __m512i two52_bits = _mm512_set1_epi64(0x4330000000000000LL);
+    const __m512i mantissa_mask = _mm512_set1_epi64(0x000FFFFFFFFFFFFFLL);
+    const __m512i one_bits = _mm512_set1_epi64(0x3FF0000000000000LL);
+    const __m512d tolerance = _mm512_set1_pd(boundary_tolerance);
+    const __m512d smallest_normal = _mm512_set1_pd(2.2250738585072014e-308);
+    const __m512d log_y_v = _mm512_set1_pd(log_y);
+    const __m512d limit = _mm512_set1_pd(multiplicity_limit);
+    const __m512d lane_offsets = _mm512_mul_pd(_mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0), _mm512_set1_pd((double)stride));
+    const __m512d step = _mm512_set1_pd(8.0*stride);
+
+    __m512d index = _mm512_add_pd(_mm512_set1_pd((double)first_index), lane_offsets);
+
+    int t = 0;
+    for (; t + 8 <= count; t += 8, index = _mm512_add_pd(index, step))
+    {
+        __m512d x = _mm512_loadu_pd(uniforms + t);
+        __m512i bits = _mm512_castpd_si512(x);
+
+        //split x into 2^k * m with m in [1,2), then move m into [sqrt(2)/2, sqrt(2))
+        __m512i exponent_bits = _mm512_or_si512(_mm512_maskz_srli_epi64(0xFF, bits, 52), two52_bits);
+        __m512d k = _mm512_sub_pd(_mm512_sub_pd(_mm512_castsi512_pd(exponent_bits), two52), _mm512_set1_pd(1023.0));
+        __m512d m = _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(bits, mantissa_mask), one_bits));
+        __mmask8 big = _mm512_cmp_pd_mask(m, sqrt2, _CMP_GT_OQ);
+        m = _mm512_mask_mul_pd(m, big, m, half);
+        k = _mm512_mask_add_pd(k, big, k, one);
+
+        //log(1+f) = f - (hfsq - s*(hfsq+R)), as in fdlibm
+        __m512d f = _mm512_sub_pd(m, one);
+        __m512d s = _mm512_div_pd(f, _mm512_add_pd(f, _mm512_set1_pd(2.0)));
+        __m512d z = _mm512_mul_pd(s, s);
+        __m512d w = _mm512_mul_pd(z, z);
+        __m512d t1 = _mm512_fmadd_pd(w, _mm512_set1_pd(Lg6), _mm512_set1_pd(Lg4));
+        t1 = _mm512_fmadd_pd(w, t1, _mm512_set1_pd(Lg2));
+        t1 = _mm512_mul_pd(w, t1);
+        __m512d t2 = _mm512_fmadd_pd(w, _mm512_set1_pd(Lg7), _mm512_set1_pd(Lg5));
+        t2 = _mm512_fmadd_pd(w, t2, _mm512_set1_pd(Lg3));
+        t2 = _mm512_fmadd_pd(w, t2, _mm512_set1_pd(Lg1));
+        t2 = _mm512_mul_pd(z, t2);
+        __m512d R = _mm512_add_pd(t1, t2);
+        __m512d hfsq = _mm512_mul_pd(half, _mm512_mul_pd(f, f));
+        __m512d inner = _mm512_fmadd_pd(s, _mm512_add_pd(hfsq, R), _mm512_mul_pd(k, _mm512_set1_pd(ln2_lo)));
+        __m512d log_x = _mm512_sub_pd(_mm512_mul_pd(k, _mm512_set1_pd(ln2_hi)), _mm512_sub_pd(_mm512_sub_pd(hfsq, inner), f));
+
+        __m512d q = _mm512_div_pd(log_x, _mm512_mul_pd(log_y_v, index));
+        __m512d floor_q = _mm512_maskz_roundscale_pd(0xFF, q, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256((__m256i*)(out + t), _mm512_maskz_cvttpd_epi32(0xFF, _mm512_maskz_min_pd(0xFF, floor_q, limit)));
+
+        //lanes too close to an integer boundary, or with inputs the bit tricks above do not cover, use the scalar log
+        __m512d margin = _mm512_mul_pd(tolerance, _mm512_add_pd(_mm512_abs_pd(q), one));
+        __m512d below = _mm512_maskz_roundscale_pd(0xFF, _mm512_sub_pd(q, margin), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        __m512d above = _mm512_maskz_roundscale_pd(0xFF, _mm512_add_pd(q, margin), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        unsigned int redo = _mm512_cmp_pd_mask(below, floor_q, _CMP_NEQ_UQ)
+                          | _mm512_cmp_pd_mask(above, floor_q, _CMP_NEQ_UQ)
+                          | _mm512_cmp_pd_mask(x, smallest_normal, _CMP_NGE_UQ);
+        for (int lane = 0; redo != 0; ++lane, redo >>= 1)
+            if (redo & 1)
+                geometricMultiplicitiesScalar(uniforms + t + lane, 1, first_index + (t + lane)*stride, stride, log_y, out + t + lane);
+    }
+
+    if (t < count)
+        geometricMultiplicitiesScalar(uniforms + t, count - t, first_index + t*stride, stride, log_y, out + t);
+}
+
+#endif
+
+
+typedef void (*GeometricKernel)(const double*, int, long long, int, double, int*);
+
+//a kernel variant and its name
+struct KernelChoice {
+    GeometricKernel kernel;
+    const char* name;
+};
+
+//pick the widest variant the processor supports
+static KernelChoice selectGeometricKernel() {
+#ifdef MULTIPLICITY_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return KernelChoice{geometricMultiplicitiesAVX512, "avx512"};
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return KernelChoice{geometricMultiplicitiesAVX2, "avx2"};
+#endif
+    return KernelChoice{geometricMultiplicitiesScalar, "scalar"};
+}
+
+//selected on first use rather than during static initialization, so creators used while other translation units are
+//being initialized still find a kernel. The initialization of a function local static is thread safe.
+static const KernelChoice& selectedKernel() {
+    static const KernelChoice choice = selectGeometricKernel();
+    return choice;
+}
+
+
+void geometricMultiplicities(const double* uniforms, int count, long long first_index, int stride, double log_y, int* out) {
+    selectedKernel().kernel(uniforms, count, first_index, stride, log_y, out);
+}
+
+
+const char* geometricKernelName() {
+    return selectedKernel().name;
+}
@@ -0,0 +1,33 @@
+//
+//  MultiplicityKernel.h
+//  ProbabilisticRejection
+//
+//  Block kernels for the geometric multiplicity loop of PartitionCreator::createPartitionGroups().
+//
+
+#ifndef MultiplicityKernel_h
+#define MultiplicityKernel_h
+
+/**
+ Computes a block of geometric multiplicities from uniforms.
+
+ For each t below count, sets out[t] = floor(log(uniforms[t])/(log_y*(first_index + t*stride))), the multiplicity of piece size first_index + t*stride, clamped to INT_MAX.
+
+ The AVX-512 or AVX2 variant is used when the processor supports it, chosen once at run time, with geometricMultiplicitiesScalar() as the fallback. The vector variants evaluate the log with a polynomial accurate to about one ulp and redo any lane that lands within rounding distance of an integer with the scalar log, so every variant returns exactly the same multiplicities.
+ @param uniforms Uniform random numbers in (0,1]. Zero is not allowed.
+ @param count Number of indices in the block.
+ @param first_index Piece size of the first index.
+ @param stride Distance between consecutive piece sizes.
+ @param log_y Log of the Boltzmann parameter, negative.
+ @param out Receives count multiplicities.
+ */
+void geometricMultiplicities(const double* uniforms, int count, long long first_index, int stride, double log_y, int* out);
+
+/** Reference scalar version of geometricMultiplicities(), one log per index.
+ @see geometricMultiplicities()*/
+void geometricMultiplicitiesScalar(const double* uniforms, int count, long long first_index, int stride, double log_y, int* out);
+
+/** Returns the name of the variant geometricMultiplicities() dispatches to: "avx512", "avx2" or "scalar". */
+const char* geometricKernelName();
+
+#endif /* MultiplicityKernel_h */
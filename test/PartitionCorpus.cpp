@@ -0,0 +1,300 @@
+//
+//  PartitionCorpus.cpp
+//  ProbabilisticRejection
+//
+//  Indexed binary files of pregenerated partitions, read through a memory map.
+//
+
+#include "PartitionCorpus.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char corpus_magic[4] = {'P', 'C', 'O', 'R'};
+static const uint32_t corpus_version = 1;
+//magic, version, record count, index offset
+static const size_t corpus_header_size = 24;
+
+
+//decodes a LEB128 varint and advances data past it
+static inline unsigned long long readVarint(const uint8_t*& data) {
+    unsigned long long value = 0;
+    int shift = 0;
+    for (;;)
+    {
+        uint8_t byte = *data++;
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+            return value;
+        shift += 7;
+    }
+}
+
+
+PartitionCorpusWriter::PartitionCorpusWriter(std::string filename) {
+    file.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+    good = file.is_open();
+
+    //the header is rewritten with the real values by close()
+    char header[corpus_header_size] = {};
+    file.write(header, corpus_header_size);
+    offsets.push_back(corpus_header_size);
+}
+
+
+PartitionCorpusWriter::~PartitionCorpusWriter() {
+    close();
+}
+
+
+bool PartitionCorpusWriter::isOpen() const {
+    return good && file.is_open();
+}
+
+
+unsigned long long PartitionCorpusWriter::recordCount() const {
+    return offsets.size() - 1;
+}
+
+
+void PartitionCorpusWriter::appendVarint(unsigned long long value) {
+    while (value >= 0x80)
+    {
+        record += (char)(value | 0x80);
+        value >>= 7;
+    }
+    record += (char)value;
+}
+
+
+void PartitionCorpusWriter::finishRecord() {
+    if (!file.is_open())
+        return;
+    file.write(record.data(), record.size());
+    good = good && file.good();
+    offsets.push_back(offsets.back() + record.size());
+}
+
+
+template <typename SizeType>
+void PartitionCorpusWriter::write(const BasicRandomPartition<SizeType>& partition) {
+    record.clear();
+    if (partition.storage == PartitionStorage::dense)
+    {
+        unsigned long long pair_count = 0;
+        for (size_t i = 1; i < partition.partition_sizes.size(); ++i)
+            pair_count += partition.partition_sizes[i] != 0;
+
+        //a dense partition covers every piece size up to its size, like the text format
+        appendVarint(partition.partition_sizes.empty() ? 0 : partition.partition_sizes.size() - 1);
+        appendVarint(pair_count);
+        size_t previous = 0;
+        for (size_t i = 1; i < partition.partition_sizes.size(); ++i)
+        {
+            if (partition.partition_sizes[i] != 0)
+            {
+                appendVarint(i - previous);
+                appendVarint(partition.partition_sizes[i]);
+                previous = i;
+            }
+        }
+    }
+    else
+    {
+        appendVarint(partition.totalSize());
+        appendVarint(partition.sparse_parts.size());
+        SizeType previous = 0;
+        for (size_t j = 0; j < partition.sparse_parts.size(); ++j)
+        {
+            appendVarint(partition.sparse_parts[j].first - previous);
+            appendVarint(partition.sparse_parts[j].second);
+            previous = partition.sparse_parts[j].first;
+        }
+    }
+    finishRecord();
+}
+
+
+void PartitionCorpusWriter::write(unsigned long long size, const std::vector<std::pair<unsigned long long,unsigned long long> >& pairs) {
+    record.clear();
+    appendVarint(size);
+    appendVarint(pairs.size());
+    unsigned long long previous = 0;
+    for (size_t j = 0; j < pairs.size(); ++j)
+    {
+        appendVarint(pairs[j].first - previous);
+        appendVarint(pairs[j].second);
+        previous = pairs[j].first;
+    }
+    finishRecord();
+}
+
+
+bool PartitionCorpusWriter::close() {
+    if (!file.is_open())
+        return good;
+
+    //align the index so the reader can use it in place
+    uint64_t index_offset = (offsets.back() + 7) & ~(uint64_t)7;
+    char padding[8] = {};
+    file.write(padding, index_offset - offsets.back());
+    file.write((const char*)&offsets[0], offsets.size()*sizeof(uint64_t));
+
+    uint64_t record_count = offsets.size() - 1;
+    file.seekp(0);
+    file.write(corpus_magic, 4);
+    file.write((const char*)&corpus_version, sizeof(corpus_version));
+    file.write((const char*)&record_count, sizeof(record_count));
+    file.write((const char*)&index_offset, sizeof(index_offset));
+
+    good = good && file.good();
+    file.close();
+    return good;
+}
+
+
+PartitionCorpus::PairIterator::PairIterator(const uint8_t* data, unsigned long long remaining) : data(data), remaining(remaining), current(0, 0) {
+    if (remaining > 0)
+        decode();
+}
+
+
+void PartitionCorpus::PairIterator::decode() {
+    current.first += readVarint(data);
+    current.second = readVarint(data);
+}
+
+
+PartitionCorpus::PairIterator& PartitionCorpus::PairIterator::operator++() {
+    if (--remaining > 0)
+        decode();
+    return *this;
+}
+
+
+PartitionCorpus::Record::Record(const uint8_t* data) {
+    partition_size = 0;
+    pair_count = 0;
+    pairs = data;
+    if (data != nullptr)
+    {
+        partition_size = readVarint(pairs);
+        pair_count = readVarint(pairs);
+    }
+}
+
+
+template <typename SizeType>
+void PartitionCorpus::Record::copyTo(BasicRandomPartition<SizeType>& output) const {
+    output.reset((SizeType)partition_size);
+    for (PairIterator it = begin(); it != end(); ++it)
+        output.setMultiplicity((SizeType)it->first, (SizeType)it->second);
+}
+
+
+PartitionCorpus::PartitionCorpus() {
+    mapping = nullptr;
+    mapping_length = 0;
+    index = nullptr;
+    record_count = 0;
+}
+
+
+PartitionCorpus::PartitionCorpus(const std::string& filename) : PartitionCorpus() {
+    open(filename);
+}
+
+
+PartitionCorpus::~PartitionCorpus() {
+    close();
+}
+
+
+bool PartitionCorpus::open(const std::string& filename) {
+    close();
+
+    int descriptor = ::open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || (size_t)status.st_size < corpus_header_size)
+    {
+        ::close(descriptor);
+        return false;
+    }
+    size_t length = status.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+    //the mapping keeps the file alive on its own
+    ::close(descriptor);
+    if (mapped == MAP_FAILED)
+        return false;
+    mapping = (const uint8_t*)mapped;
+    mapping_length = length;
+
+    uint32_t version;
+    uint64_t records, index_offset;
+    std::memcpy(&version, mapping + 4, sizeof(version));
+    std::memcpy(&records, mapping + 8, sizeof(records));
+    std::memcpy(&index_offset, mapping + 16, sizeof(index_offset));
+
+    //check the header and the ends of the index. Records in between are trusted, so opening stays independent of the corpus size.
+    bool valid = std::memcmp(mapping, corpus_magic, 4) == 0 && version == corpus_version && index_offset % 8 == 0
+        && index_offset <= length && records < (length - index_offset)/sizeof(uint64_t)
+        && index_offset + (records + 1)*sizeof(uint64_t) == length;
+    if (valid)
+    {
+        index = (const uint64_t*)(mapping + index_offset);
+        valid = index[0] == corpus_header_size && index[records] <= index_offset;
+    }
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    record_count = records;
+    return true;
+}
+
+
+void PartitionCorpus::close() {
+    if (mapping != nullptr)
+        munmap((void*)mapping, mapping_length);
+    mapping = nullptr;
+    mapping_length = 0;
+    index = nullptr;
+    record_count = 0;
+}
+
+
+bool PartitionCorpus::isOpen() const {
+    return mapping != nullptr;
+}
+
+
+size_t PartitionCorpus::recordCount() const {
+    return record_count;
+}
+
+
+PartitionCorpus::Record PartitionCorpus::record(size_t k) const {
+    return Record(mapping + index[k]);
+}
+
+
+template <typename SizeType>
+bool PartitionCorpus::read(size_t k, BasicRandomPartition<SizeType>& output) const {
+    if (k >= record_count)
+        return false;
+    record(k).copyTo(output);
+    return true;
+}
+
+
+template void PartitionCorpusWriter::write<int>(const RandomPartition& partition);
+template void PartitionCorpusWriter::write<long long>(const RandomPartition64& partition);
+template void PartitionCorpus::Record::copyTo<int>(RandomPartition& output) const;
+template void PartitionCorpus::Record::copyTo<long long>(RandomPartition64& output) const;
+template bool PartitionCorpus::read<int>(size_t k, RandomPartition& output) const;
+template bool PartitionCorpus::read<long long>(size_t k, RandomPartition64& output) const;
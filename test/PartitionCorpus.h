@@ -0,0 +1,178 @@
+//
+//  PartitionCorpus.h
+//  ProbabilisticRejection
+//
+//  Indexed binary files of pregenerated partitions, read through a memory map.
+//
+
+#ifndef PartitionCorpus_h
+#define PartitionCorpus_h
+
+#include "PartitionCreator.h"
+#include <stdint.h>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ Corpus file layout, all fixed width fields native endian:
+
+ - header: "PCOR", uint32 version (1), uint64 record count, uint64 offset of the index
+ - records, one after another. Each record is the partition size, the number of nonzero multiplicities, and then
+   for every nonzero multiplicity in increasing piece size order the distance from the previous piece size (from 0
+   for the first) and the multiplicity, all as LEB128 varints
+ - padding to a multiple of 8 bytes, then the index: record count + 1 uint64 file offsets, the start of every record
+   followed by the end of the last one
+ */
+
+/**
+ Writes partitions to a corpus file. Records are streamed to the file as they are written, only the index is kept in memory until close().
+ @see PartitionCorpus
+ */
+class PartitionCorpusWriter {
+public:
+    /** Constructor. Creates or truncates the file.
+     @param filename Full file name, conventionally ending in .corpus.*/
+    PartitionCorpusWriter(std::string filename);
+    /** Destructor. Calls close(). */
+    ~PartitionCorpusWriter();
+
+    /** Returns whether the file could be opened and every write so far succeeded. */
+    bool isOpen() const;
+    /** Number of records written so far. */
+    unsigned long long recordCount() const;
+
+    /** Appends a partition as the next record. Any storage layout is accepted. */
+    template <typename SizeType>
+    void write(const BasicRandomPartition<SizeType>& partition);
+
+    /**
+     Appends a record given as (piece size, multiplicity) pairs, for callers that never build a partition.
+     @param size Partition size.
+     @param pairs Nonzero multiplicities in increasing piece size order.
+     */
+    void write(unsigned long long size, const std::vector<std::pair<unsigned long long,unsigned long long> >& pairs);
+
+    /** Writes the index and header and closes the file. Nothing is readable before this. Does nothing when already closed.
+     @return true if the whole file was written successfully.*/
+    bool close();
+
+private:
+    PartitionCorpusWriter(const PartitionCorpusWriter&) = delete;
+    PartitionCorpusWriter& operator=(const PartitionCorpusWriter&) = delete;
+
+    /** Appends a varint to the record being built. */
+    void appendVarint(unsigned long long value);
+    /** Writes the record being built and adds it to the index. */
+    void finishRecord();
+
+    std::ofstream file;
+    /** Whether the file is open and all writes succeeded. */
+    bool good;
+    /** Encoded record, reused between records. */
+    std::string record;
+    /** File offset of every record written so far, then of the end of the last record. */
+    std::vector<uint64_t> offsets;
+};
+
+
+/**
+ Read only view of a corpus file. The file is memory mapped, so opening costs the same for any corpus size, record(k) finds any record in constant time through the index, and records are decoded straight from the mapped pages without copying the file.
+
+ A corpus may be read from any number of threads at once.
+ @see PartitionCorpusWriter
+ */
+class PartitionCorpus {
+public:
+    /** Forward iterator over the (piece size, multiplicity) pairs of a record, decoding them from the mapped file on the fly. */
+    class PairIterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<unsigned long long,unsigned long long> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type* pointer;
+        typedef const value_type& reference;
+
+        PairIterator(const uint8_t* data = nullptr, unsigned long long remaining = 0);
+
+        reference operator*() const { return current; }
+        pointer operator->() const { return &current; }
+        PairIterator& operator++();
+        PairIterator operator++(int) { PairIterator previous = *this; ++*this; return previous; }
+        bool operator==(const PairIterator& other) const { return remaining == other.remaining; }
+        bool operator!=(const PairIterator& other) const { return remaining != other.remaining; }
+
+    private:
+        /** Decodes the pair at data into current. */
+        void decode();
+
+        const uint8_t* data;
+        /** Pairs left, including current. Iterators of one record compare equal when they have the same number left. */
+        unsigned long long remaining;
+        value_type current;
+    };
+
+    /** One record of the corpus. Only valid while its corpus is open. */
+    class Record {
+    public:
+        Record(const uint8_t* data = nullptr);
+
+        /** Partition size. */
+        unsigned long long size() const { return partition_size; }
+        /** Number of nonzero multiplicities. */
+        unsigned long long pairCount() const { return pair_count; }
+        /** First (piece size, multiplicity) pair, in increasing piece size order. */
+        PairIterator begin() const { return PairIterator(pairs, pair_count); }
+        /** Past the last pair. */
+        PairIterator end() const { return PairIterator(); }
+
+        /** Overwrites a partition with this record, keeping the partition's storage layout. */
+        template <typename SizeType>
+        void copyTo(BasicRandomPartition<SizeType>& output) const;
+
+    private:
+        unsigned long long partition_size;
+        unsigned long long pair_count;
+        /** Start of the encoded pairs. */
+        const uint8_t* pairs;
+    };
+
+    /** Constructor. Creates a corpus with no file open. */
+    PartitionCorpus();
+    /** Constructor. Opens a file, check isOpen() for success. */
+    PartitionCorpus(const std::string& filename);
+    /** Destructor. Unmaps the file. */
+    ~PartitionCorpus();
+
+    /** Maps a corpus file, closing any previous one. Returns false if the file could not be mapped or is not a valid corpus. */
+    bool open(const std::string& filename);
+    /** Unmaps the file. Records taken from it become invalid. */
+    void close();
+    /** Returns whether a corpus is open. */
+    bool isOpen() const;
+
+    /** Number of records, zero when nothing is open. */
+    size_t recordCount() const;
+    /** Returns record k, which must be below recordCount(). */
+    Record record(size_t k) const;
+    /** Overwrites a partition with record k, keeping the partition's storage layout. Returns false if k is out of range. */
+    template <typename SizeType>
+    bool read(size_t k, BasicRandomPartition<SizeType>& output) const;
+
+private:
+    PartitionCorpus(const PartitionCorpus&) = delete;
+    PartitionCorpus& operator=(const PartitionCorpus&) = delete;
+
+    /** Start of the mapping, nullptr when nothing is open. */
+    const uint8_t* mapping;
+    /** Length of the mapping in bytes. */
+    size_t mapping_length;
+    /** Index inside the mapping, record count + 1 entries. */
+    const uint64_t* index;
+    size_t record_count;
+};
+
+#endif /* PartitionCorpus_h */
@@ -0,0 +1,270 @@
+//
+//  PartitionCountTable.cpp
+//  ProbabilisticRejection
+//
+//  Exact partition counts p(n), used by the table based uniform sampler.
+//
+
+#include "PartitionCountTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+BigCount::BigCount(unsigned long long value) {
+    while (value != 0)
+    {
+        limbs.push_back((uint32_t)value);
+        value >>= 32;
+    }
+}
+
+
+void BigCount::trim() {
+    while (!limbs.empty() && limbs.back() == 0)
+        limbs.pop_back();
+}
+
+
+BigCount& BigCount::operator+=(const BigCount& other) {
+    if (limbs.size() < other.limbs.size())
+        limbs.resize(other.limbs.size(), 0);
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < limbs.size(); ++i)
+    {
+        uint64_t sum = carry + limbs[i] + (i < other.limbs.size() ? other.limbs[i] : 0);
+        limbs[i] = (uint32_t)sum;
+        carry = sum >> 32;
+        if (carry == 0 && i >= other.limbs.size())
+            break;
+    }
+    if (carry != 0)
+        limbs.push_back((uint32_t)carry);
+    return *this;
+}
+
+
+BigCount& BigCount::operator-=(const BigCount& other) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < limbs.size(); ++i)
+    {
+        int64_t difference = (int64_t)limbs[i] - borrow - (i < other.limbs.size() ? other.limbs[i] : 0);
+        borrow = difference < 0 ? 1 : 0;
+        limbs[i] = (uint32_t)(difference + (borrow << 32));
+        if (borrow == 0 && i >= other.limbs.size())
+            break;
+    }
+    trim();
+    return *this;
+}
+
+
+void BigCount::setProduct(const BigCount& value, uint32_t factor) {
+    limbs.resize(value.limbs.size());
+    uint64_t carry = 0;
+    for (size_t i = 0; i < value.limbs.size(); ++i)
+    {
+        uint64_t product = (uint64_t)value.limbs[i]*factor + carry;
+        limbs[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    if (carry != 0)
+        limbs.push_back((uint32_t)carry);
+    trim();
+}
+
+
+int BigCount::compare(const BigCount& other) const {
+    if (limbs.size() != other.limbs.size())
+        return limbs.size() < other.limbs.size() ? -1 : 1;
+    for (size_t i = limbs.size(); i-- > 0; )
+    {
+        if (limbs[i] != other.limbs[i])
+            return limbs[i] < other.limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+
+double BigCount::log() const {
+    if (limbs.empty())
+        return -HUGE_VAL;
+
+    //the top two limbs carry all the precision a double has
+    size_t top = limbs.size() - 1;
+    double leading = limbs[top];
+    if (top > 0)
+        leading = leading*4294967296.0 + limbs[top-1];
+    size_t dropped = top > 0 ? top - 1 : 0;
+    return std::log(leading) + dropped*32*std::log(2.0);
+}
+
+
+void BigCount::setUniformBelow(const BigCount& bound, std::mt19937_64& generator) {
+    //draw as many random bits as bound has and reject values that are too large, which happens less than half the time
+    size_t top = bound.limbs.size() - 1;
+    uint32_t top_mask = bound.limbs[top];
+    top_mask |= top_mask >> 1;
+    top_mask |= top_mask >> 2;
+    top_mask |= top_mask >> 4;
+    top_mask |= top_mask >> 8;
+    top_mask |= top_mask >> 16;
+
+    do
+    {
+        limbs.resize(bound.limbs.size());
+        for (size_t i = 0; i < limbs.size(); ++i)
+            limbs[i] = (uint32_t)generator();
+        limbs[top] &= top_mask;
+        trim();
+    } while (compare(bound) >= 0);
+}
+
+
+//sets value to p(m) from p(0) to p(m-1) in counts by Euler's pentagonal number recurrence, with the added and
+//subtracted terms summed separately. negative is scratch space.
+static void pentagonalCount(const std::vector<BigCount>& counts, int m, BigCount& value, BigCount& negative) {
+    value.limbs.clear();
+    negative.limbs.clear();
+    for (int k = 1; k*(3*k-1)/2 <= m; ++k)
+    {
+        int pentagonal = k*(3*k-1)/2;
+        BigCount& sum = (k % 2) ? value : negative;
+        sum += counts[m-pentagonal];
+        if (pentagonal + k <= m)
+            sum += counts[m-pentagonal-k];
+    }
+    value -= negative;
+}
+
+
+//layout: "PCNT", entry count, then per entry its limb count and limbs, all native endian
+static bool writeCounts(const std::vector<BigCount>& counts, const std::string& filename) {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open())
+        return false;
+    uint32_t entries = (uint32_t)counts.size();
+    file.write("PCNT", 4);
+    file.write((const char*)&entries, sizeof(entries));
+    for (size_t m = 0; m < counts.size(); ++m)
+    {
+        uint32_t length = (uint32_t)counts[m].limbs.size();
+        file.write((const char*)&length, sizeof(length));
+        if (length > 0)
+            file.write((const char*)&counts[m].limbs[0], length*sizeof(uint32_t));
+    }
+    return file.good();
+}
+
+
+PartitionCountTable& PartitionCountTable::shared() {
+    static PartitionCountTable instance;
+    return instance;
+}
+
+
+PartitionCountTable::PartitionCountTable() {
+    table = std::make_shared<const std::vector<BigCount> >(1, BigCount(1));
+    
+    //the default cache, so that every process using the table shares one file without any setup in code
+    const char* default_cache = std::getenv("PARTITION_COUNT_CACHE");
+    if (default_cache != nullptr && *default_cache != 0)
+        setCacheFile(default_cache);
+}
+
+
+std::shared_ptr<const std::vector<BigCount> > PartitionCountTable::counts(int n) {
+    std::lock_guard<std::mutex> guard(table_lock);
+    if ((int)table->size() > n)
+        return table;
+
+    //published tables are never modified, so grow a copy. Grow to at least twice the size so repeated
+    //small extensions do not copy the table over and over.
+    std::shared_ptr<std::vector<BigCount> > grown = std::make_shared<std::vector<BigCount> >(*table);
+    int old_size = (int)grown->size();
+    int new_size = std::max(n + 1, 2*old_size);
+    grown->resize(new_size);
+
+    BigCount negative;
+    for (int m = old_size; m < new_size; ++m)
+        pentagonalCount(*grown, m, (*grown)[m], negative);
+
+    table = grown;
+    if (!cache_file.empty())
+        writeCounts(*table, cache_file);
+    return table;
+}
+
+
+bool PartitionCountTable::setCacheFile(const std::string& filename) {
+    bool loaded = loadFromFile(filename);
+    std::lock_guard<std::mutex> guard(table_lock);
+    cache_file = filename;
+    return loaded;
+}
+
+
+bool PartitionCountTable::saveToFile(const std::string& filename) {
+    return writeCounts(*counts(0), filename);
+}
+
+
+//entries at the end of a loaded file that are recomputed before the file is accepted
+static const uint32_t loaded_spot_checks = 16;
+
+
+bool PartitionCountTable::loadFromFile(const std::string& filename) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[4];
+    uint32_t entries = 0;
+    file.read(magic, 4);
+    file.read((char*)&entries, sizeof(entries));
+    if (!file || std::string(magic, 4) != "PCNT" || entries == 0)
+        return false;
+
+    //every entry holds at least its 4 byte length, so a corrupt count is caught before anything is allocated for it
+    std::streampos header_end = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff remaining = file.tellg() - header_end;
+    file.seekg(header_end);
+    if (!file || remaining < 0 || (unsigned long long)remaining/sizeof(uint32_t) < entries)
+        return false;
+
+    std::shared_ptr<std::vector<BigCount> > loaded = std::make_shared<std::vector<BigCount> >(entries);
+    for (uint32_t m = 0; m < entries; ++m)
+    {
+        uint32_t length = 0;
+        file.read((char*)&length, sizeof(length));
+        //p(m) is positive and has far fewer than m+1 limbs, anything else means a corrupt file
+        if (!file || length == 0 || length > m + 1)
+            return false;
+        (*loaded)[m].limbs.resize(length);
+        file.read((char*)&(*loaded)[m].limbs[0], length*sizeof(uint32_t));
+        if (!file || (*loaded)[m].limbs.back() == 0)
+            return false;
+    }
+
+    //a wrong count would bias the table sampler without any error, so check the file before trusting it: the prefix
+    //against the compile time counts, and the last entries against the recurrence, which reads about sqrt(m) earlier ones
+    for (uint32_t m = 0; m < entries && m <= (uint32_t)small_partition_count_limit; ++m)
+    {
+        if ((*loaded)[m].compare(BigCount(small_partition_counts.value[m])) != 0)
+            return false;
+    }
+    BigCount expected, negative;
+    for (uint32_t m = std::max<uint32_t>(entries, loaded_spot_checks) - loaded_spot_checks; m < entries; ++m)
+    {
+        pentagonalCount(*loaded, (int)m, expected, negative);
+        if ((*loaded)[m].compare(expected) != 0)
+            return false;
+    }
+
+    std::lock_guard<std::mutex> guard(table_lock);
+    if (loaded->size() > table->size())
+        table = loaded;
+    return true;
+}
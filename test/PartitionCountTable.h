@@ -0,0 +1,128 @@
+//
+//  PartitionCountTable.h
+//  ProbabilisticRejection
+//
+//  Exact partition counts p(n), used by the table based uniform sampler.
+//
+
+#ifndef PartitionCountTable_h
+#define PartitionCountTable_h
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ A nonnegative integer of arbitrary size, stored as 32 bit limbs with the least significant limb first.
+ Only the operations the partition count recurrence and the table sampler need are provided.
+ */
+class BigCount {
+public:
+    /** Constructor. Creates a count with the given value. */
+    BigCount(unsigned long long value = 0);
+
+    /** Limbs, least significant first, without leading zero limbs. Zero has no limbs. */
+    std::vector<uint32_t> limbs;
+
+    /** Adds another count to this one. */
+    BigCount& operator+=(const BigCount& other);
+    /** Subtracts another count from this one. The other count must not be larger. */
+    BigCount& operator-=(const BigCount& other);
+    /** Sets this count to value*factor, reusing this count's storage. */
+    void setProduct(const BigCount& value, uint32_t factor);
+    /** Returns a negative number, zero or a positive number when this count is smaller than, equal to or larger than the other. */
+    int compare(const BigCount& other) const;
+    /** Returns the natural log of the count, or -infinity for zero. */
+    double log() const;
+
+    /**
+     Sets this count to a uniformly random value in [0, bound), reusing this count's storage.
+     @param bound Exclusive upper bound, must be positive.
+     @param generator Source of randomness.
+     */
+    void setUniformBelow(const BigCount& bound, std::mt19937_64& generator);
+
+private:
+    /** Drops leading zero limbs. */
+    void trim();
+};
+
+
+/** Number of entries in smallPartitionCounts(). p(416) is the largest partition count that fits in 64 bits. */
+static const int small_partition_count_limit = 416;
+
+/** Compile time table of p(0) to p(416). */
+struct SmallPartitionCounts {
+    unsigned long long value[small_partition_count_limit+1];
+};
+
+/** Builds the compile time table with Euler's pentagonal number recurrence. The recurrence subtracts, but arithmetic modulo 2^64 still lands on the exact counts since they all fit. */
+constexpr SmallPartitionCounts makeSmallPartitionCounts() {
+    SmallPartitionCounts table = {};
+    table.value[0] = 1;
+    for (int m = 1; m <= small_partition_count_limit; ++m)
+    {
+        unsigned long long total = 0;
+        for (int k = 1; k*(3*k-1)/2 <= m; ++k)
+        {
+            int pentagonal = k*(3*k-1)/2;
+            unsigned long long term = table.value[m-pentagonal];
+            if (pentagonal + k <= m)
+                term += table.value[m-pentagonal-k];
+            total = (k % 2) ? total + term : total - term;
+        }
+        table.value[m] = total;
+    }
+    return table;
+}
+
+/** p(0) to p(416), computed at compile time. */
+constexpr SmallPartitionCounts small_partition_counts = makeSmallPartitionCounts();
+
+
+/**
+ Exact partition counts p(0), p(1), ..., shared by every thread of the process.
+
+ The table grows on demand and is never modified once published: callers receive a shared snapshot that stays valid however much other threads extend the table afterwards. Snapshots are cheap to copy and may be read concurrently without locking.
+
+ Building the table takes O(n^1.5) big number additions. To avoid paying that in every process, give the table a cache file with setCacheFile(): the table is loaded from it immediately, and saved to it every time it grows. The shared table takes the file named by the PARTITION_COUNT_CACHE environment variable, if that is set, as soon as it is first used, which covers every sampler and tool without changes.
+ */
+class PartitionCountTable {
+public:
+    /** Returns the process wide table. */
+    static PartitionCountTable& shared();
+
+    /**
+     Returns a snapshot holding at least p(0) to p(n), extending the table first if needed.
+     @param n Largest partition count needed.
+     */
+    std::shared_ptr<const std::vector<BigCount> > counts(int n);
+
+    /**
+     Loads the table from a file, if the file exists and holds more counts than the table, and saves the table there whenever it grows.
+     @param filename File used to persist the table.
+     @return true if counts were loaded from the file.
+     */
+    bool setCacheFile(const std::string& filename);
+
+    /** Writes the current table to a file. Returns false if the file could not be written. */
+    bool saveToFile(const std::string& filename);
+    /** Replaces the table by the one stored in a file, if that one is larger. The file is checked first: its counts up to p(416) against the compile time table, and its last 16 counts against the recurrence. Returns false if the file could not be read or failed the check. */
+    bool loadFromFile(const std::string& filename);
+
+private:
+    /** Constructor. Starts with p(0) only. */
+    PartitionCountTable();
+
+    /** Guards table and cache_file. Held only to take or publish a snapshot, and while growing the table. */
+    std::mutex table_lock;
+    /** Latest published counts. */
+    std::shared_ptr<const std::vector<BigCount> > table;
+    /** File the table is saved to after growing, empty for none. */
+    std::string cache_file;
+};
+
+#endif /* PartitionCountTable_h */
@@ -7,6 +7,10 @@
 //
 
 #include "PartitionCreator.h"
+#include "MultiplicityKernel.h"
+#include "PartitionCountTable.h"
+#include "PartitionStatistics.h"
+#include "RestrictionPolicy.h"
 #include <cmath>
 #include <cfloat>
 #include <random>
@@ -14,762 +18,1705 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <type_traits>
 
-PartitionCreator::PartitionCreator() {
+template <typename SizeType>
+BasicRandomPartition<SizeType>::BasicRandomPartition(PartitionStorage::storageTypes layout) {
+    storage = layout;
+}
+
+
+template <typename SizeType>
+void BasicRandomPartition<SizeType>::reset(SizeType size) {
+    if (storage == dense)
+        partition_sizes.assign(size+1, 0);
+    else
+        sparse_parts.clear();
+}
+
+
+template <typename SizeType>
+SizeType BasicRandomPartition<SizeType>::getMultiplicity(SizeType part) const {
+    if (storage == dense)
+        return (part > 0 && part < (SizeType)partition_sizes.size()) ? partition_sizes[part] : 0;
+    
+    //pairs are sorted by piece size, so binary search for the requested one
+    typename std::vector<std::pair<SizeType,SizeType> >::const_iterator it = std::lower_bound(sparse_parts.begin(), sparse_parts.end(), std::make_pair(part, (SizeType)0));
+    if (it != sparse_parts.end() && it->first == part)
+        return it->second;
+    return 0;
+}
+
+
+template <typename SizeType>
+void BasicRandomPartition<SizeType>::setMultiplicity(SizeType part, SizeType multiplicity) {
+    if (storage == dense)
+    {
+        partition_sizes[part] = multiplicity;
+        return;
+    }
+    
+    //common case: samplers fill piece sizes in increasing order, so just append
+    if (sparse_parts.empty() || sparse_parts.back().first < part)
+    {
+        if (multiplicity != 0)
+            sparse_parts.push_back(std::make_pair(part, multiplicity));
+        return;
+    }
+    
+    typename std::vector<std::pair<SizeType,SizeType> >::iterator it = std::lower_bound(sparse_parts.begin(), sparse_parts.end(), std::make_pair(part, (SizeType)0));
+    if (it->first == part)
+    {
+        if (multiplicity != 0)
+            it->second = multiplicity;
+        else
+            sparse_parts.erase(it);
+    }
+    else if (multiplicity != 0)
+        sparse_parts.insert(it, std::make_pair(part, multiplicity));
+}
+
+
+template <typename SizeType>
+SizeType BasicRandomPartition<SizeType>::totalSize() const {
+    SizeType size = 0;
+    if (storage == dense)
+    {
+        for(SizeType i = 1; i<(SizeType)partition_sizes.size(); ++i)
+            size += i*partition_sizes[i];
+    }
+    else
+    {
+        for(size_t i = 0; i<sparse_parts.size(); ++i)
+            size += sparse_parts[i].first*sparse_parts[i].second;
+    }
+    return size;
+}
+
+
+//Wraps statements that only exist in builds collecting sampling statistics
+#ifdef PARTITION_CREATOR_STATS
+#define CREATOR_STATS(...) __VA_ARGS__
+#else
+#define CREATOR_STATS(...)
+#endif
+
+
+PartitionCreatorStats::PartitionCreatorStats() {
+#ifdef PARTITION_CREATOR_STATS
+    enabled = true;
+#else
+    enabled = false;
+#endif
+    clear();
+}
+
+
+double PartitionCreatorStats::acceptanceRate() const {
+    return attempts > 0 ? (double)accepted_attempts/attempts : 0.0;
+}
+
+
+void PartitionCreatorStats::addDeficit(long long k) {
+    if (k < 0)
+    {
+        ++negative_deficits;
+        return;
+    }
+    size_t bucket = 0;
+    for (; k != 0; k >>= 1)
+        ++bucket;
+    if (deficit_histogram.size() <= bucket)
+        deficit_histogram.resize(bucket + 1, 0);
+    ++deficit_histogram[bucket];
+}
+
+
+void PartitionCreatorStats::merge(const PartitionCreatorStats& other) {
+    samples += other.samples;
+    attempts += other.attempts;
+    accepted_attempts += other.accepted_attempts;
+    generation_seconds += other.generation_seconds;
+    acceptance_seconds += other.acceptance_seconds;
+    allocation_bytes += other.allocation_bytes;
+    negative_deficits += other.negative_deficits;
+    if (deficit_histogram.size() < other.deficit_histogram.size())
+        deficit_histogram.resize(other.deficit_histogram.size(), 0);
+    for (size_t b = 0; b < other.deficit_histogram.size(); ++b)
+        deficit_histogram[b] += other.deficit_histogram[b];
+}
+
+
+void PartitionCreatorStats::clear() {
+    samples = 0;
+    attempts = 0;
+    accepted_attempts = 0;
+    generation_seconds = 0.0;
+    acceptance_seconds = 0.0;
+    allocation_bytes = 0;
+    negative_deficits = 0;
+    deficit_histogram.clear();
+}
+
+
+std::string PartitionCreatorStats::toJson() const {
+    std::ostringstream json;
+    json << "{\"enabled\": " << (enabled ? "true" : "false") << ", \"samples\": " << samples << ", \"attempts\": " << attempts
+        << ", \"accepted_attempts\": " << accepted_attempts << ", \"acceptance_rate\": " << acceptanceRate()
+        << ", \"generation_seconds\": " << generation_seconds << ", \"acceptance_seconds\": " << acceptance_seconds
+        << ", \"allocation_bytes\": " << allocation_bytes << ", \"negative_deficits\": " << negative_deficits << ", \"deficit_histogram\": [";
+    for (size_t b = 0; b < deficit_histogram.size(); ++b)
+        json << (b > 0 ? ", " : "") << deficit_histogram[b];
+    json << "]}";
+    return json.str();
+}
+
+
+#ifdef PARTITION_CREATOR_STATS
+//bytes held by the storage of a partition
+template <typename SizeType>
+static size_t storageBytes(const BasicRandomPartition<SizeType>& partition) {
+    return partition.partition_sizes.capacity()*sizeof(SizeType) + partition.sparse_parts.capacity()*sizeof(std::pair<SizeType,SizeType>);
+}
+#endif
+
+
+SamplerState::SamplerState() {
+    U = 0.0;
+    attempt_count = 0;
+    
+    //mix the clock with the hardware entropy source so that states made in the same tick still differ
+    std::random_device device;
+    unsigned long long time_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::seed_seq sequence{device(), device(), (unsigned int)time_seed, (unsigned int)(time_seed >> 32)};
+    generator.seed(sequence);
+}
+
+
+SamplerState::SamplerState(unsigned long long seed, unsigned long long stream) {
+    U = 0.0;
+    attempt_count = 0;
+    this->seed(seed, stream);
+}
+
+
+void SamplerState::seed(unsigned long long seed, unsigned long long stream) {
+    //seed_seq scrambles every word of the seed and the stream id into the full engine state,
+    //so neighbouring stream ids give unrelated engines rather than shifted copies of one sequence.
+    std::seed_seq sequence{(unsigned int)seed, (unsigned int)(seed >> 32), (unsigned int)stream, (unsigned int)(stream >> 32)};
+    generator.seed(sequence);
+}
+
+
+bool SamplerState::cancelled() const {
+    return cancel_check && cancel_check();
+}
+
+
+template <typename SizeType>
+BasicSamplerPlan<SizeType>::BasicSamplerPlan() {
+    goal_size = 0;
+    restriction = PartitionCreatorBase::none;
+    largest_allowed_part = 0;
+    largest_part = 0;
+    requested_algorithm = PartitionCreatorBase::div_conquer_deterministic;
+    algorithm = PartitionCreatorBase::div_conquer_deterministic;
+    valid = false;
+    log_x = 0.0;
+    log_peak = 0.0;
+    poisson_tail_start = 0;
+}
+
+
+template <typename SizeType>
+BasicPartitionCreator<SizeType>::BasicPartitionCreator() {
     current_restriction = none;
+    largest_allowed_part = 0;
+    current_storage = PartitionStorage::dense;
+    skip_sampling = false;
+}
+
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::seed(unsigned long long seed, unsigned long long stream) {
+    own_state.seed(seed, stream);
 }
 
 
-void PartitionCreator::setRestriction(enum PartitionCreator::activeRestrictions restriction) {
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::setRestriction(activeRestrictions restriction, SizeType largest_part) {
     current_restriction = restriction;
+    largest_allowed_part = largest_part;
 }
 
-RandomPartition* PartitionCreator::generateRandomPartition(int size, enum PartitionCreator::sampleAlgorithms algo) {
-    //error handling: do not generate partitions of size zero or less
-    if (size<=0)
-        return nullptr;
-    
-    RandomPartition* partition = nullptr;
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::setStorage(PartitionStorage::storageTypes storage) {
+    current_storage = storage;
+}
+
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::setSkipSampling(bool enabled) {
+    skip_sampling = enabled;
+}
+
+
+template <typename SizeType>
+unsigned long long BasicPartitionCreator<SizeType>::attemptCount() const {
+    return own_state.attempt_count;
+}
+
+
+template <typename SizeType>
+const PartitionCreatorStats& BasicPartitionCreator<SizeType>::stats() const {
+#ifdef PARTITION_CREATOR_STATS
+    return own_state.stats;
+#else
+    static const PartitionCreatorStats disabled;
+    return disabled;
+#endif
+}
+
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::resetStats() {
+    CREATOR_STATS(own_state.stats.clear();)
+}
+
+
+#ifdef PARTITION_CREATOR_STATS
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::recordAttempt(SamplerState& state, const Partition& attempt, size_t storage_before, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point generated, bool accepted) const {
+    std::chrono::steady_clock::time_point checked = std::chrono::steady_clock::now();
+    state.stats.generation_seconds += std::chrono::duration<double>(generated - start).count();
+    state.stats.acceptance_seconds += std::chrono::duration<double>(checked - generated).count();
+    ++state.stats.attempts;
+    if (accepted)
+        ++state.stats.accepted_attempts;
+    size_t storage_after = storageBytes(attempt);
+    if (storage_after > storage_before)
+        state.stats.allocation_bytes += storage_after - storage_before;
+}
+#endif
+
+
+template <typename SizeType>
+BasicRandomPartition<SizeType>* BasicPartitionCreator<SizeType>::generateRandomPartition(SizeType size, sampleAlgorithms algo) {
+    Partition* partition = new Partition(current_storage);
     
-    //use the algorithm passed by the user. Has a default value in the header, check if interested.
-    switch (algo) {
+    if (!generateRandomPartition(*partition, size, algo))
+    {
+        delete partition;
+        return nullptr;
+    }
+    return partition;
+}
+
+
+template <typename SizeType>
+bool BasicPartitionCreator<SizeType>::generateRandomPartition(Partition& partition, SizeType size, sampleAlgorithms algo) {
+    return generateRandomPartition(partition, cachedPlan(size, algo, current_restriction, largest_allowed_part));
+}
+
+
+template <typename SizeType>
+bool BasicPartitionCreator<SizeType>::generateRandomPartition(Partition& partition, const Plan& plan) {
+    return generateRandomPartition(partition, plan, own_state);
+}
+
+
+template <typename SizeType>
+bool BasicPartitionCreator<SizeType>::generateRandomPartition(Partition& partition, SizeType size, sampleAlgorithms algo, activeRestrictions restriction, SizeType largest_part, SamplerState& state) const {
+    return generateRandomPartition(partition, makePlan(size, algo, restriction, largest_part), state);
+}
+
+
+template <typename SizeType>
+bool BasicPartitionCreator<SizeType>::generateRandomPartition(Partition& partition, const Plan& plan, SamplerState& state) const {
+    //error handling: the plan found no partition of its size, or the size was zero or less
+    if (!plan.valid)
+        return false;
+    
+    CREATOR_STATS(++state.stats.samples;)
+    
+    //run the samplers compiled for the plan's restriction
+    switch (plan.restriction) {
+        case none:
+            generateWithPolicy<AllParts>(partition, plan, state);
+            break;
+        case even_parts:
+            generateWithPolicy<EvenParts>(partition, plan, state);
+            break;
+        case odd_parts:
+            generateWithPolicy<OddParts>(partition, plan, state);
+            break;
+        case distinct_parts:
+            generateWithPolicy<DistinctParts>(partition, plan, state);
+            break;
+        case odd_distinct_parts:
+            generateWithPolicy<OddDistinctParts>(partition, plan, state);
+            break;
+    }
+    //a cancelled sampler returns early, with the partition incomplete
+    return !state.cancelled();
+}
+
+
+//Whether size has a partition into pieces of the policy's class no larger than largest_part
+template <typename Policy>
+static bool hasPartition(long long size, long long largest_part) {
+    static_assert((Policy::first_part == 1 && Policy::part_step <= 2) || Policy::first_part == Policy::part_step,
+                  "allowed piece sizes must start at 1 with a step of 1 or 2, or be the multiples of part_step");
+    long long step = Policy::part_step;
+    
+    //a class of multiples of the step is the class of all piece sizes scaled up
+    if (Policy::first_part != 1)
+    {
+        if (size % step != 0)
+            return false;
+        size /= step;
+        largest_part /= step;
+        step = 1;
+    }
+    if (largest_part < 1)
+        return false;
+    if (Policy::max_multiplicity == 0)
+        return true;
+    
+    //with multiplicities capped at b, every size up to the sum of all allowed pieces is reachable,
+    //except for distinct odd pieces: j of them sum to a number of j's parity between j^2 and count^2 - (count-j)^2
+    double count = (largest_part - 1)/step + 1;
+    double b = Policy::max_multiplicity;
+    if (step == 1)
+        return size <= b*count*(count + 1)/2;
+    if (Policy::max_multiplicity > 1)
+        return size <= b*count*count;
+    for (long long j = size % 2; j*j <= size; j += 2)
+    {
+        if (j > 0 && size <= j*(2*count - j))
+            return true;
+    }
+    return false;
+}
+
+
+template <typename SizeType>
+template <typename Policy>
+void BasicPartitionCreator<SizeType>::generateWithPolicy(Partition& partition, const Plan& plan, SamplerState& state) const {
+    switch (plan.algorithm) {
         case rejection_sample:
-        {
-            partition = rejectionSample(size);
+            rejectionSample<Policy>(partition, plan, state);
             break;
-        }
         case div_conquer_deterministic:
-        {
-            partition = divConquerDeterministic(size);
+            if (!plan.small_odd_blocks.empty())
+                oddDistinctDivConquer(partition, plan, state);
+            else
+                divConquerDeterministic<Policy>(partition, plan, state);
             break;
-        }
         case self_similar_div_conquer:
-        {
-            //partition = selfSimilarDivConquer(size);
+            selfSimilarDivConquer(partition, plan, state);
             break;
+        case exact_table:
+            exactTableSample(partition, plan, state);
+            break;
+        case poisson_process:
+            divConquerDeterministic<Policy>(partition, plan, state, true);
+            break;
+    }
+}
+
+
+template <typename SizeType>
+BasicRandomPartition<SizeType> BasicPartitionCreator<SizeType>::generatePartition(SizeType size, sampleAlgorithms algo) {
+    Partition partition(current_storage);
+    generateRandomPartition(partition, size, algo);
+    return partition;
+}
+
+
+template <typename SizeType>
+std::vector<BasicRandomPartition<SizeType>*> BasicPartitionCreator<SizeType>::generateBatch(SizeType size, int count, sampleAlgorithms algo, int threads) {
+    std::vector<Partition*> batch;
+    
+    //error handling: same conditions as generateRandomPartition, plus a positive count
+    if (size<=0 || count<=0)
+        return batch;
+    
+    //every worker samples from the same plan, made once here
+    const Plan& plan = cachedPlan(size, algo, current_restriction, largest_allowed_part);
+    if (!plan.valid)
+        return batch;
+    batch.resize(count, nullptr);
+    
+    if (threads<=0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > count)
+        threads = count;
+    
+    //every worker stream is split off one value drawn from our own engine, the workers share this creator and only
+    //their sampler states are their own
+    unsigned long long batch_seed = own_state.generator();
+    
+    //workers claim sample indices one at a time, so a long rejection run does not stall the other threads
+    std::atomic<int> next_sample(0);
+    std::atomic<unsigned long long> batch_attempts(0);
+    CREATOR_STATS(std::mutex stats_lock;)
+    
+    const BasicPartitionCreator& shared = *this;
+    auto work = [&](int worker_id) {
+        SamplerState state(batch_seed, worker_id);
+        
+        for (int i = next_sample++; i < count; i = next_sample++)
+        {
+            Partition* partition = new Partition(current_storage);
+            if (!shared.generateRandomPartition(*partition, plan, state))
+            {
+                delete partition;
+                partition = nullptr;
+            }
+            batch[i] = partition;
         }
-        default:
+        batch_attempts += state.attempt_count;
+        CREATOR_STATS(std::lock_guard<std::mutex> guard(stats_lock); own_state.stats.merge(state.stats);)
+    };
+    
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.push_back(std::thread(work, t));
+    
+    //the calling thread takes part as worker zero
+    work(0);
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+    
+    own_state.attempt_count += batch_attempts;
+    return batch;
+}
+
+
+template <typename SizeType>
+unsigned long long BasicPartitionCreator<SizeType>::generateStatistics(Statistics& output, SizeType size, unsigned long long count, sampleAlgorithms algo, int threads) {
+    //error handling: same conditions as generateRandomPartition, plus a positive count
+    if (size<=0 || count==0)
+        return 0;
+    const Plan& plan = cachedPlan(size, algo, current_restriction, largest_allowed_part);
+    if (!plan.valid)
+        return 0;
+    
+    if (threads<=0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if ((unsigned long long)threads > count)
+        threads = (int)count;
+    
+    unsigned long long batch_seed = own_state.generator();
+    
+    //every worker reduces into its own statistics, so adding takes no lock, and they are merged in worker order below
+    std::vector<Statistics> partial(threads, Statistics(output.trackedParts()));
+    std::vector<SamplerState> states;
+    for (int t = 0; t < threads; ++t)
+        states.push_back(SamplerState(batch_seed, t));
+    
+    const BasicPartitionCreator& shared = *this;
+    auto work = [&](int worker_id) {
+        Partition partition(current_storage);
+        unsigned long long share = count/threads + ((unsigned long long)worker_id < count % threads ? 1 : 0);
+        for (unsigned long long s = 0; s < share; ++s)
         {
-            std::cout << "Generate Random Partition ran without a valid function enum";
-            exit(5);
+            shared.generateRandomPartition(partition, plan, states[worker_id]);
+            partial[worker_id].add(partition);
         }
+    };
+    
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.push_back(std::thread(work, t));
+    
+    //the calling thread takes part as worker zero
+    work(0);
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+    
+    for (int t = 0; t < threads; ++t)
+    {
+        output.merge(partial[t]);
+        own_state.attempt_count += states[t].attempt_count;
+        CREATOR_STATS(own_state.stats.merge(states[t].stats);)
     }
-    return partition;
+    return count;
 }
 
 
-RandomPartition* PartitionCreator::rejectionSample(int goal_size) {
-    RandomPartition* test_partition = nullptr;
-    
-    //rerun the algorithm until it works.
+template <typename SizeType>
+template <typename Policy>
+void BasicPartitionCreator<SizeType>::rejectionSample(Partition& test_partition, const Plan& plan, SamplerState& state) const {
+    const SizeType goal_size = plan.goal_size;
+    const SizeType largest_part = plan.largest_part;
+    const double log_x = plan.log_x;
+    
+    //rerun the algorithm until it works or is cancelled. Every attempt overwrites the same partition, so its storage is reused.
     for (;;)
     {
-        //keep a counter to compare the number of partitions with the result
-        int counter = 0;
-        
-        //delete the last partition allocation if one exists
-        if (test_partition!=nullptr)
-            delete test_partition;
+        if (state.cancelled())
+            return;
         
-        RandomPartition* test_partition = nullptr;
-
         //use uniform distributions to generate numbers for partition groups.
         //partition_size[i] is the number of "i" sized partition groups.
         //Note that we index from 1 to goal_size.
         
-        test_partition = createPartitionGroups(goal_size,1);
-        
-        //count if we generated a partition of the correct size.
-        for(int i = 1; i < test_partition->partition_sizes.size(); ++i){
-            counter += i * test_partition->partition_sizes[i];
-        }
+        CREATOR_STATS(size_t storage_before = storageBytes(test_partition); std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();)
+        SizeType counter = createPartitionGroups<Policy>(test_partition, goal_size, Policy::first_part, largest_part, log_x, state);
+        ++state.attempt_count;
+        CREATOR_STATS(std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now();)
+        CREATOR_STATS(recordAttempt(state, test_partition, storage_before, start, generated, counter==goal_size);)
 
         //conclude if we hit the goal size
         if (counter==goal_size) {
-            return test_partition;
+            return;
         }
     }
 } 
 
-RandomPartition* PartitionCreator::divConquerDeterministic(int goal_size){
-    RandomPartition* test_partition = nullptr;
-    
-    //rerun the algorithm until it works.
+template <typename SizeType>
+template <typename Policy>
+void BasicPartitionCreator<SizeType>::divConquerDeterministic(Partition& test_partition, const Plan& plan, SamplerState& state, bool poisson_attempts) const {
+    //The multiplicity j of the smallest allowed piece size a is left out of the attempts. Given the other multiplicities,
+    //it must fill the deficit k = j*a exactly, which it does with probability proportional to x^k, for j up to the
+    //policy's max_multiplicity. Dividing by the largest such probability, plan.log_peak, gives the acceptance.
+    //Deficits of either parity are fine for odd parts: they start at 3, and pieces of size 1 fill any k.
+    const SizeType a = Policy::first_part;
+    const int b = Policy::max_multiplicity;
+    const SizeType goal_size = plan.goal_size;
+    const SizeType largest_part = plan.largest_part;
+    const double log_x = plan.log_x;
+    const double log_peak = plan.log_peak;
+    
+    //rerun the algorithm until it works or is cancelled. Every attempt overwrites the same partition, so its storage is reused.
     for (;;)
     {
-        //delete the last partition allocation if one exists
-        if (test_partition != nullptr)
-            delete test_partition;
+        if (state.cancelled())
+            return;
+        CREATOR_STATS(size_t storage_before = storageBytes(test_partition); std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();)
+        SizeType drawn = poisson_attempts ? poissonMultiplicities<Policy>(test_partition, plan, state)
+                                          : createPartitionGroups<Policy>(test_partition, goal_size, a + Policy::part_step, largest_part, log_x, state);
+        SizeType k = goal_size - drawn;
+        ++state.attempt_count;
+        CREATOR_STATS(std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now();)
+        
+        SizeType j = k/a;
+        bool accepted = k >= 0 && k % a == 0 && (b == 0 || j <= b) && state.U < exp(k*log_x - log_peak);
+        CREATOR_STATS(state.stats.addDeficit(k); recordAttempt(state, test_partition, storage_before, start, generated, accepted);)
+        if (accepted) {
+            if (j != 0)
+                test_partition.setMultiplicity(a, j);
+            return;
+        }
+    }
+}
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::oddDistinctDivConquer(Partition& test_partition, const Plan& plan, SamplerState& state) const {
+    //The attempts draw the odd piece sizes from 2m+1 on, for the largest block m. The deficit k must be filled by a set
+    //of 1, 3, ..., 2m-1, which happens with probability proportional to count(k)*x^k, and dividing by its largest value
+    //gives the acceptance. Given k, the set is uniform among those with sum k, which is the same problem on the block:
+    //the piece sizes of its upper half are drawn with the same x, and the next block, its lower half, fills the rest
+    //with the acceptance of its own counts. The block of size 0 is filled only by a deficit of 0.
+    const std::vector<int>& blocks = plan.small_odd_blocks;
+    const SizeType goal_size = plan.goal_size;
+    const double log_x = plan.log_x;
+    const SizeType m = blocks[0];
+    std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
+
+    //rerun the algorithm until it works or is cancelled. Every attempt overwrites the same partition, so its storage is reused.
+    SizeType k;
+    for (;;)
+    {
+        if (state.cancelled())
+            return;
+        CREATOR_STATS(size_t storage_before = storageBytes(test_partition); std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();)
+        SizeType drawn = createPartitionGroups<OddDistinctParts>(test_partition, goal_size, 2*m + 1, plan.largest_part, log_x, state);
+        k = goal_size - drawn;
+        ++state.attempt_count;
+        CREATOR_STATS(std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now();)
+
+        bool accepted = k >= 0 && k <= m*m && state.U < exp(plan.small_odd_log_counts[k] + k*log_x - plan.small_odd_log_peaks[0]);
+        CREATOR_STATS(state.stats.addDeficit(k); recordAttempt(state, test_partition, storage_before, start, generated, accepted);)
+        if (accepted)
+            break;
+    }
+
+    //fill the deficit block by block, collecting the piece sizes from the largest down
+    std::vector<SizeType> small_parts;
+    size_t row = 0;
+    for (size_t l = 0; blocks[l] > 0; ++l)
+    {
+        const SizeType upper = blocks[l];
+        const SizeType lower = blocks[l+1];
+        row += (size_t)upper*upper + 1;
+        const size_t kept = small_parts.size();
+        for (;;)
+        {
+            small_parts.resize(kept);
+            SizeType sum = 0;
+            for (SizeType i = 2*upper - 1; i > 2*lower; i -= 2)
+            {
+                double y = exp(i*log_x);
+                if (uni_distribution(state.generator)*(1.0 + y) < y)
+                {
+                    small_parts.push_back(i);
+                    sum += i;
+                }
+            }
+            SizeType d = k - sum;
+            if (d >= 0 && d <= lower*lower && uni_distribution(state.generator) < exp(plan.small_odd_log_counts[row + d] + d*log_x - plan.small_odd_log_peaks[l+1]))
+            {
+                k = d;
+                break;
+            }
+        }
+    }
+
+    //the attempt only set piece sizes above 2m, so the small ones go in front, smallest first
+    if (test_partition.storage == PartitionStorage::dense)
+    {
+        for (size_t t = 0; t < small_parts.size(); ++t)
+            test_partition.setMultiplicity(small_parts[t], 1);
+        return;
+    }
+    test_partition.sparse_parts.insert(test_partition.sparse_parts.begin(), small_parts.size(), std::make_pair((SizeType)0, (SizeType)1));
+    for (size_t t = 0; t < small_parts.size(); ++t)
+        test_partition.sparse_parts[small_parts.size() - 1 - t].first = small_parts[t];
+}
+
+//log p(m) for small m, read off the shared exact count table so the pentagonal recurrence lives in one place
+static const int exact_partition_count_limit = 1000;
+
+static const std::vector<double>& smallLogPartitionCounts() {
+    static const std::vector<double> logs = []() {
+        std::shared_ptr<const std::vector<BigCount> > counts = PartitionCountTable::shared().counts(exact_partition_count_limit);
+        std::vector<double> log_p(exact_partition_count_limit+1);
+        for (int m = 0; m <= exact_partition_count_limit; ++m)
+            log_p[m] = (*counts)[m].log();
+        return log_p;
+    }();
+    return logs;
+}
+
+//log p(m). Above the exact table, the first Rademacher term is used, whose relative error there is below e^-40.
+static double logPartitionCount(long long m) {
+    if (m <= exact_partition_count_limit)
+        return smallLogPartitionCounts()[m];
+    
+    const double pi = 3.14159265358979323846;
+    double K = pi*sqrt(2.0/3.0);
+    double lambda = sqrt(m - 1.0/24.0);
+    
+    //p(m) ~ 1/(pi*sqrt(2)) * d/dm[sinh(K*lambda)/lambda], with sinh and cosh both e^(K*lambda)/2 at this size
+    return K*lambda - log(2.0) - log(pi*sqrt(2.0)) - log(2.0*lambda) + log(K/lambda - 1.0/(lambda*lambda));
+}
+
+
+//Boltzmann parameter of a self similar round with remaining left to generate. The conditional law of the even half
+//does not depend on it, so the leading order value does.
+static double selfSimilarLogX(long long remaining) {
+    return -3.14159265358979323846/sqrt(6.0*remaining);
+}
+
+
+//Log of the largest weight p(m)*x^(2m) of an even half of total 2m, for m up to half.
+//That is log-concave past m = 25, so scan the start and binary search for the peak after it.
+static double evenHalfLogMax(long long half, double log_x) {
+    double log_max = -DBL_MAX;
+    for (long long m = 0; m <= std::min(half, 32LL); ++m)
+        log_max = std::max(log_max, logPartitionCount(m) + 2*m*log_x);
+    long long low = 32, high = half;
+    while (low < high)
+    {
+        long long mid = low + (high - low)/2;
+        if (logPartitionCount(mid+1) + 2*(mid+1)*log_x > logPartitionCount(mid) + 2*mid*log_x)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low <= half)
+        log_max = std::max(log_max, logPartitionCount(low) + 2*low*log_x);
+    return log_max;
+}
+
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::selfSimilarDivConquer(Partition& output, const Plan& plan, SamplerState& state) const
+{
+    std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
+    const SizeType goal_size = plan.goal_size;
     
-        test_partition = createPartitionGroups(goal_size,2);
-        //test_partition->partition_sizes.erase(test_partition->partition_sizes.begin()+1);
+    //pieces found so far, already scaled to their final size
+    std::vector<std::pair<SizeType,SizeType> > pieces;
+    Partition odd_half(Partition::sparse);
+    
+    //remaining is the size of the partition still to be generated, and every piece of it is later multiplied by scale
+    SizeType remaining = goal_size;
+    SizeType scale = 1;
+    while (remaining > 0)
+    {
+        //tune the parameter to the size left at this round. The even half has total 2m with probability proportional
+        //to p(m)*x^(2m), whose peak bounds the acceptance. The first round's constants come with the plan.
+        double log_x = plan.log_x;
+        double log_max = plan.log_peak;
+        if (remaining != goal_size)
+        {
+            log_x = selfSimilarLogX(remaining);
+            log_max = evenHalfLogMax(remaining/2, log_x);
+        }
         
-        int k = goal_size;
-        for(int i = 2; i <= goal_size; ++i){
-            k -= i*test_partition->partition_sizes[i];
+        //rerun this round until the odd half leaves an even amount the even half is likely enough to fill
+        SizeType m;
+        for (;;)
+        {
+            if (state.cancelled())
+                return;
+            CREATOR_STATS(size_t storage_before = storageBytes(odd_half); std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();)
+            odd_half.reset(remaining);
+            skipMultiplicities<OddParts>(odd_half, 1, remaining, log_x, state);
+            ++state.attempt_count;
+            CREATOR_STATS(std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now();)
+            
+            SizeType leftover = remaining - odd_half.totalSize();
+            m = leftover/2;
+            bool accepted = leftover >= 0 && leftover % 2 == 0
+                && log(1.0 - uni_distribution(state.generator)) < logPartitionCount(m) + 2*m*log_x - log_max;
+            CREATOR_STATS(recordAttempt(state, odd_half, storage_before, start, generated, accepted);)
+            if (accepted)
+                break;
         }
         
-        if(k >= 0 && U < exp(-k*3.14159/sqrt(6*goal_size))) {
-            //test_partition->partition_sizes.insert(test_partition->partition_sizes.begin()+1, k);
-            test_partition->partition_sizes[1] = k;
-            return test_partition;
+        for (size_t j = 0; j < odd_half.sparse_parts.size(); ++j)
+            pieces.push_back(std::make_pair(odd_half.sparse_parts[j].first*scale, odd_half.sparse_parts[j].second));
+        
+        remaining = m;
+        scale *= 2;
+    }
+    
+    //every piece size has one odd part and one power of two, so rounds never share a piece size
+    std::sort(pieces.begin(), pieces.end());
+    output.reset(goal_size);
+    for (size_t j = 0; j < pieces.size(); ++j)
+        output.setMultiplicity(pieces[j].first, pieces[j].second);
+}
+
+//largest m for which m*p(m) still fits in 64 bits
+static const int exact_table_small_limit = 326;
+
+//sums of the divisors of every s up to n, by adding every d to its multiples
+static void fillDivisorSums(std::vector<unsigned int>& sigma, int n) {
+    sigma.assign(n + 1, 0);
+    for (int d = 1; d <= n; ++d)
+    {
+        for (int t = d; t <= n; t += d)
+            sigma[t] += d;
+    }
+}
+
+
+//divisor d of s picked with probability d/sigma(s)
+static int pickDivisor(std::vector<int>& divisors, int s, unsigned int sigma_s, RandomEngine& generator) {
+    divisors.clear();
+    for (int d = 1; d*d <= s; ++d)
+    {
+        if (s % d == 0)
+        {
+            divisors.push_back(d);
+            if (d*d != s)
+                divisors.push_back(s/d);
         }
     }
+    
+    std::uniform_int_distribution<unsigned int> pick(0, sigma_s - 1);
+    unsigned int r = pick(generator);
+    for (size_t i = 0; ; ++i)
+    {
+        if (r < (unsigned int)divisors[i])
+            return divisors[i];
+        r -= divisors[i];
+    }
 }
 
-RandomPartition* PartitionCreator::selfSimilarDivConquer(int goal_size)
+
+template <typename SizeType>
+void BasicPartitionCreator<SizeType>::exactTableSample(Partition& output, const Plan& plan, SamplerState& state) const
 {
-    //In progress
-    return nullptr;
+    const SizeType goal_size = plan.goal_size;
+    
+    //never rejects, so every sample is a single attempt
+    ++state.attempt_count;
+    CREATOR_STATS(size_t storage_before = storageBytes(output); std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();)
+    
+    //chosen (piece size, count) pairs. A piece size can be chosen more than once
+    std::vector<std::pair<SizeType,SizeType> > pieces;
+    
+    //m*p(m) = sum over d,j with jd <= m of d*p(m-jd). Grouping the terms by s = jd gives m*p(m) = sum of sigma(s)*p(m-s),
+    //where sigma(s) is the sum of the divisors of s. A uniform number below m*p(m) picks s by walking that sum, which
+    //almost always stops within a few sqrt(m) terms, and then d is a divisor of s picked with probability d/sigma(s).
+    const std::vector<unsigned int>& sigma = plan.divisor_sums;
+    std::vector<int> divisors;
+    
+    int m = (int)goal_size;
+    if (goal_size <= exact_table_small_limit)
+    {
+        const unsigned long long* p = small_partition_counts.value;
+        while (m > 0)
+        {
+            std::uniform_int_distribution<unsigned long long> pick(0, (unsigned long long)m*p[m] - 1);
+            unsigned long long r = pick(state.generator);
+            int s = 1;
+            for (;; ++s)
+            {
+                unsigned long long weight = (unsigned long long)sigma[s]*p[m-s];
+                if (r < weight)
+                    break;
+                r -= weight;
+            }
+            int d = pickDivisor(divisors, s, sigma[s], state.generator);
+            pieces.push_back(std::make_pair(d, s/d));
+            m -= s;
+        }
+    }
+    else
+    {
+        const std::vector<BigCount>& p = *plan.partition_counts;
+        BigCount total, r, weight;
+        while (m > 0)
+        {
+            total.setProduct(p[m], m);
+            r.setUniformBelow(total, state.generator);
+            int s = 1;
+            for (;; ++s)
+            {
+                weight.setProduct(p[m-s], sigma[s]);
+                if (r.compare(weight) < 0)
+                    break;
+                r -= weight;
+            }
+            int d = pickDivisor(divisors, s, sigma[s], state.generator);
+            pieces.push_back(std::make_pair(d, s/d));
+            m -= s;
+        }
+    }
+    
+    //merge repeated piece sizes and store in increasing order
+    std::sort(pieces.begin(), pieces.end());
+    output.reset(goal_size);
+    for (size_t i = 0; i < pieces.size(); )
+    {
+        SizeType multiplicity = 0;
+        size_t first = i;
+        for (; i < pieces.size() && pieces[i].first == pieces[first].first; ++i)
+            multiplicity += pieces[i].second;
+        output.setMultiplicity(pieces[first].first, multiplicity);
+    }
+    CREATOR_STATS(std::chrono::steady_clock::time_point generated = std::chrono::steady_clock::now(); recordAttempt(state, output, storage_before, start, generated, true);)
 }
 
-//DEBUG
 
-void detectTrapped(int& ctr){
-    if (ctr<1000000)
-        ctr++;
-    else
+//Expected size of an attempt that draws every allowed piece size from start_pos up to largest_part with Boltzmann parameter e^log_x,
+//and its derivative with respect to log_x in slope
+template <typename Policy>
+static double expectedAttemptSize(double log_x, long long start_pos, long long largest_part, double& slope) {
+    const int b = Policy::max_multiplicity;
+    double total = 0.0;
+    slope = 0.0;
+    for (long long i = start_pos; i <= largest_part; i += Policy::part_step)
+    {
+        double l = i*log_x;
+        //later pieces add less than e^-50 each
+        if (l < -50)
+            break;
+        //mean multiplicity y/(1-y) for y = e^l, less the part above max_multiplicity when it is capped.
+        //h = 1/(e^(-kl) - 1) has derivative k*h*(h + 1) in l.
+        double mean = 1.0/expm1(-l);
+        double mean_slope = mean*(mean + 1);
+        if (b > 0)
+        {
+            double capped = 1.0/expm1(-(b + 1)*l);
+            mean -= (b + 1)*capped;
+            mean_slope -= (b + 1)*(b + 1)*capped*(capped + 1);
+        }
+        total += i*mean;
+        slope += (double)i*i*mean_slope;
+    }
+    return total;
+}
+
+
+//Solves for the log of the Boltzmann parameter that gives attempts an expected size of size, by Newton's method
+//from guess, falling back to bisection whenever a step leaves the bracket
+template <typename Policy>
+static double solveLogX(double size, long long start_pos, long long largest_part, double guess) {
+    //The expected size grows with log_x. Unlimited multiplicities need x < 1, capped ones may go past it when size is
+    //close to the largest size the pieces can make.
+    double low = -50.0;
+    double high = Policy::max_multiplicity == 0 ? -1e-300 : 50.0;
+    double log_x = std::min(std::max(guess, low), high);
+    for (int round = 0; round < 100; ++round)
+    {
+        double slope;
+        double error = expectedAttemptSize<Policy>(log_x, start_pos, largest_part, slope) - size;
+        if (error < 0)
+            low = log_x;
+        else
+            high = log_x;
+        
+        double next = log_x - error/slope;
+        if (!(next > low && next < high))
+            next = (low + high)/2;
+        if (std::abs(next - log_x) <= 1e-15*std::abs(log_x) || error == 0)
+            return next;
+        log_x = next;
+    }
+    return log_x;
+}
+
+
+//Log of the Boltzmann parameter x for attempts that draw every allowed piece size from start_pos up to largest_part,
+//solved so that their expected size is size
+template <typename Policy>
+static double boltzmannLogX(long long size, long long start_pos, long long largest_part) {
+    //For x = 1 - s and unbounded piece sizes an attempt has expected size close to share*(pi^2/6)/s^2, where share is
+    //the fraction of allowed piece sizes, times b/(b+1) when multiplicities are capped at b. That only holds to
+    //leading order, so it is the starting point for solving the exact expected size over the piece sizes the attempts
+    //actually draw.
+    //An attempt from start_pos = first_part hits size with chance c_size*x^size/Z(x), with Z the product of the
+    //multiplicity generating functions, which peaks where the expected size is size. Divide and conquer accepts with
+    //that chance times the generating function of the piece size it leaves out, for x < 1, so its acceptance
+    //c_size*x^size/Z' peaks where the expected size of the pieces it draws, from start_pos on, is size.
+    double c = 3.14159265358979323846/sqrt(6.0);
+    double share = 1.0/Policy::part_step;
+    if (Policy::max_multiplicity > 0)
+        share *= Policy::max_multiplicity/(Policy::max_multiplicity + 1.0);
+    double s = c*sqrt(share/size);
+    double guess = s < 0.5 ? log(1 - s) : -s;
+    return solveLogX<Policy>(size, start_pos, largest_part, guess);
+}
+
+
+//Piece sizes with x^i below e^-13.8, about 10^-6, expect too few arrivals to be worth a block and are skip sampled
+static const double poisson_tail_log = -13.8;
+
+
+//Ends of the Poisson process blocks of the piece sizes from start_pos on, measured from the start of the first, and the
+//first piece size left to skip sampling
+template <typename Policy>
+static long long poissonBlockEnds(std::vector<double>& ends, long long start_pos, long long largest_part, double log_x) {
+    ends.clear();
+    double end = 0.0;
+    long long i = start_pos;
+    for (; i <= largest_part && i*log_x >= poisson_tail_log; i += Policy::part_step)
     {
-        std::string a;
-        std::cout << "Trapped.";
+        //the chance of no arrival in the block is the chance of a zero multiplicity: 1 - y, or 1/(1 + y) for distinct parts
+        double l = i*log_x;
+        end += Policy::max_multiplicity == 1 ? log1p(exp(l)) : -log(-expm1(l));
+        ends.push_back(end);
     }
+    return i;
 }
 
 
-//calculate A baseed on z, the random variable we're calculating for
-double getAValue(int current_z_interval, int size){
-    double c = 3.14159/sqrt(6);
-    double x = exp(-((c*current_z_interval) / (sqrt(size))));
-    return x;
+//Sets the constants of rejection sampling or divide and conquer attempts that draw up to plan.largest_part and aim
+//at target
+template <typename Policy, typename SizeType>
+static void setAttemptConstants(BasicSamplerPlan<SizeType>& plan, long long target) {
+    if (plan.algorithm == PartitionCreatorBase::rejection_sample)
+    {
+        plan.log_x = boltzmannLogX<Policy>(target, Policy::first_part, plan.largest_part);
+        return;
+    }
+    
+    //divide and conquer leaves the smallest piece size out, and a deficit of j of them has weight x^(a*j) for
+    //j up to b. The largest weight is x^0 for x < 1 and x^(a*b) for x > 1.
+    const int a = Policy::first_part;
+    const int b = Policy::max_multiplicity;
+    plan.log_x = boltzmannLogX<Policy>(target, a + Policy::part_step, plan.largest_part);
+    plan.log_peak = (b > 0 && plan.log_x > 0) ? b*a*plan.log_x : 0.0;
+    plan.poisson_ends.clear();
+    if (plan.algorithm == PartitionCreatorBase::poisson_process && plan.log_x < 0)
+        plan.poisson_tail_start = poissonBlockEnds<Policy>(plan.poisson_ends, a + Policy::part_step, plan.largest_part, plan.log_x);
 }
 
-double getAValueFixed(int current_z_interval, int size){
-    double c = 3.14159/sqrt(6);
-    return c/sqrt(size);
+
+//Largest block of small odd piece sizes divide and conquer for distinct odd parts leaves out. Its count table takes
+//about m^3/3 additions and m^2 doubles, and the counts, below 2^m, stay within double range.
+static const int small_odd_block_limit = 1000;
+
+//Sets the blocks of small odd piece sizes of divide and conquer for distinct odd parts and their count tables
+template <typename SizeType>
+static void setSmallOddBlocks(BasicSamplerPlan<SizeType>& plan) {
+    //The deficit of an attempt spreads over about goal_size^(3/4), mostly from piece sizes around 1/log(1/x). A block
+    //reaching up to 2/log(1/x) holds about a fifth of that variance, enough to keep the acceptance rate bounded.
+    //All piece sizes are tilted by the same x, so x is the one whose expected size over every odd piece is goal_size.
+    plan.log_x = boltzmannLogX<OddDistinctParts>(plan.goal_size, OddDistinctParts::first_part, plan.largest_part);
+    long long m = plan.log_x < -1.0/small_odd_block_limit ? (long long)ceil(-1.0/plan.log_x) : small_odd_block_limit;
+    m = std::min(m, ((long long)plan.largest_part + 1)/2);
+
+    plan.small_odd_blocks.clear();
+    for (; m > 0; m /= 2)
+        plan.small_odd_blocks.push_back((int)m);
+    plan.small_odd_blocks.push_back(0);
+
+    //count the sets of 1, 3, ..., 2i-1 by sum for i up to the largest block, keeping the rows of the blocks.
+    //The sums of the first i odd numbers reach i^2.
+    const std::vector<int>& blocks = plan.small_odd_blocks;
+    std::vector<size_t> offsets(blocks.size());
+    size_t total = 0;
+    for (size_t l = 0; l < blocks.size(); ++l)
+    {
+        offsets[l] = total;
+        total += (size_t)blocks[l]*blocks[l] + 1;
+    }
+    plan.small_odd_log_counts.assign(total, 0.0);
+    plan.small_odd_log_peaks.assign(blocks.size(), 0.0);
+
+    std::vector<double> counts((size_t)blocks[0]*blocks[0] + 1, 0.0);
+    counts[0] = 1.0;
+    size_t l = blocks.size() - 1;
+    for (long long i = 0; i <= blocks[0]; ++i)
+    {
+        if (i > 0)
+        {
+            for (long long j = i*i; j >= 2*i - 1; --j)
+                counts[j] += counts[j - (2*i - 1)];
+        }
+        if (i != blocks[l])
+            continue;
+
+        double peak = -std::numeric_limits<double>::infinity();
+        for (long long j = 0; j <= i*i; ++j)
+        {
+            double log_count = counts[j] > 0 ? log(counts[j]) : -std::numeric_limits<double>::infinity();
+            plan.small_odd_log_counts[offsets[l] + j] = log_count;
+            peak = std::max(peak, log_count + j*plan.log_x);
+        }
+        plan.small_odd_log_peaks[l] = peak;
+        if (l > 0)
+            --l;
+    }
 }
 
 
-
-
-//return the length of the next target section
-double getNextTargetLen(int current_z_interval, int current_y_interval, int size) {
-    
-    double a = getAValue(current_z_interval, size);
-    int exponent_term = current_z_interval * current_y_interval;
-    
-    return pow(a,exponent_term)/ current_y_interval;
+template <typename SizeType>
+BasicSamplerPlan<SizeType> BasicPartitionCreator<SizeType>::makePlan(SizeType size, sampleAlgorithms algo) const {
+    return makePlan(size, algo, current_restriction, largest_allowed_part);
 }
 
-//Find the length over which the current multiplicities' 'a' values will converge
-double getZIntervalEnd(int current_z_interval, int size) {
 
+template <typename SizeType>
+BasicSamplerPlan<SizeType> BasicPartitionCreator<SizeType>::makePlan(SizeType size, sampleAlgorithms algo, activeRestrictions restriction, SizeType largest_allowed) const {
+    Plan plan;
+    plan.goal_size = size;
+    plan.restriction = restriction;
+    plan.largest_allowed_part = largest_allowed;
+    plan.requested_algorithm = algo;
+    plan.algorithm = algo;
     
-    double error_bound = pow(2.0,-52);
-    
-    double past_val_1 = 0.0;
-    double past_val_2 = -10000.0; //quickly erased in next step...
+    //error handling: do not generate partitions of size zero or less
+    if (size<=0)
+        return plan;
     
-    int curr_interval = 0;
+    //pieces larger than size can never be used, so they need no bound
+    plan.largest_part = (largest_allowed > 0 && largest_allowed < size) ? largest_allowed : size;
     
-    //stop when no distance gained implying s has converged
-    while (past_val_1-past_val_2>=error_bound)
-    {
-        past_val_2=past_val_1;
-        curr_interval++;
-        double next_interval_length = getNextTargetLen(current_z_interval, curr_interval, size);
-        past_val_1 += next_interval_length;
-        //std::cout << past_val_1 << std::endl;
+    switch (restriction) {
+        case none:
+            fillPlan<AllParts>(plan);
+            break;
+        case even_parts:
+            fillPlan<EvenParts>(plan);
+            break;
+        case odd_parts:
+            fillPlan<OddParts>(plan);
+            break;
+        case distinct_parts:
+            fillPlan<DistinctParts>(plan);
+            break;
+        case odd_distinct_parts:
+            fillPlan<OddDistinctParts>(plan);
+            break;
+        default:
+            //error handling: an unknown restriction leaves the plan invalid, so nothing is generated from it
+            break;
     }
-    
-    return past_val_1;
+    return plan;
 }
 
 
-//calculate j, the interval end for a single z multiplicity
-double getZIntervalEndUsingJ(int current_z_interval, int size) {
-    double c = 3.14159/sqrt(6);
-    double e = 2.718;
-    
-    double i = current_z_interval;
-    
-    double power = ((-c * i)/sqrt(size));
-    double epow = pow(e, power);
-    
-    return -52.0/log(1-epow);
+template <typename SizeType>
+template <typename Policy>
+void BasicPartitionCreator<SizeType>::fillPlan(Plan& plan) const {
+    //error handling: the samplers would never terminate on sizes without a partition in the class
+    if (!hasPartition<Policy>(plan.goal_size, plan.largest_part))
+        return;
+    plan.valid = true;
+    
+    //self similar divide and conquer and the exact table are built on the structure of unrestricted partitions,
+    //and restricted classes fall back to divide and conquer
+    bool unrestricted = std::is_same<Policy, AllParts>::value && plan.largest_part == plan.goal_size;
+    if ((plan.algorithm == self_similar_div_conquer || plan.algorithm == exact_table) && !unrestricted)
+        plan.algorithm = div_conquer_deterministic;
+    //the count table is indexed by int, and could not be held in memory long before that limit anyway
+    if (plan.algorithm == exact_table && plan.goal_size > std::numeric_limits<int>::max())
+        plan.algorithm = self_similar_div_conquer;
+    //the Poisson process has no blocks for multiplicities capped above 1
+    if (plan.algorithm == poisson_process && Policy::max_multiplicity > 1)
+        plan.algorithm = div_conquer_deterministic;
+    
+    switch (plan.algorithm) {
+        case rejection_sample:
+        case div_conquer_deterministic:
+        case poisson_process:
+        {
+            setAttemptConstants<Policy>(plan, plan.goal_size);
+            //distinct odd parts leave out a whole block of small piece sizes instead of just 1, with its own x
+            if (plan.algorithm == div_conquer_deterministic && std::is_same<Policy, OddDistinctParts>::value)
+                setSmallOddBlocks(plan);
+            break;
+        }
+        case self_similar_div_conquer:
+        {
+            plan.log_x = selfSimilarLogX(plan.goal_size);
+            plan.log_peak = evenHalfLogMax(plan.goal_size/2, plan.log_x);
+            break;
+        }
+        case exact_table:
+        {
+            fillDivisorSums(plan.divisor_sums, (int)plan.goal_size);
+            if (plan.goal_size > exact_table_small_limit)
+                plan.partition_counts = PartitionCountTable::shared().counts((int)plan.goal_size);
+            break;
+        }
+        default:
+        {
+            //error handling: an unknown algorithm makes the plan invalid, so nothing is generated from it
+            plan.valid = false;
+            break;
+        }
+    }
 }
 
 
-double getEndOfPoissonUsingUpperBound (int size) {
-    
-    //generate s, end of poisson process, using upper bounding
-    
-    double c = 3.14159/sqrt(6);
-    double pi = 3.141592;
-    double x = exp(-(c / (sqrt(size))));
-    
-    return ((pi*pi)/6)*(x/(1-x));
-
+template <typename SizeType>
+const BasicSamplerPlan<SizeType>& BasicPartitionCreator<SizeType>::cachedPlan(SizeType size, sampleAlgorithms algo, activeRestrictions restriction, SizeType largest_allowed) {
+    if (last_plan.goal_size != size || last_plan.requested_algorithm != algo || last_plan.restriction != restriction
+        || last_plan.largest_allowed_part != largest_allowed)
+        last_plan = makePlan(size, algo, restriction, largest_allowed);
+    return last_plan;
 }
 
-//Generate s, the end of the poisson process.
-double getEndOfPoisson(int size) {
-    double c = 3.14159/sqrt(6);
-    double x = exp(-(c / (sqrt(size))));
-    
-    double error_bound = pow(2.0,-52);
-    
-    double past_val_1 = 0.0;
-    double past_val_2 = -10000.0; //quickly erased in next step...
-    
-    int j = 1;
-    
-    //stop when no distance gained implying s has converged
-    while (past_val_1-past_val_2>=error_bound)
+
+template <typename SizeType>
+SizeType BasicPartitionCreator<SizeType>::generateSweep(SizeType smallest, SizeType largest, const SweepVisitor& visit, sampleAlgorithms algo) {
+    //error handling: do not generate partitions of size zero or less
+    if (smallest<=0 || largest<smallest)
+        return 0;
+    //error handling: same as an unknown algorithm in makePlan()
+    if (algo != rejection_sample && algo != div_conquer_deterministic && algo != self_similar_div_conquer
+        && algo != exact_table && algo != poisson_process)
+        return 0;
+    
+    //these draw no attempts that several sizes could share
+    if (algo == self_similar_div_conquer || algo == exact_table)
     {
-        past_val_2 = past_val_1;
-        past_val_1 += 1.0/(j*j) * (j*(pow(x,j)) /(1.0-pow(x,j)));
-        j++;
-    
+        SizeType generated = 0;
+        Partition output(current_storage);
+        for (SizeType n = smallest; n <= largest; ++n)
+        {
+            if (generateRandomPartition(output, n, algo))
+            {
+                visit(n, output);
+                ++generated;
+            }
+        }
+        return generated;
     }
     
-    return past_val_1;
-    
+    switch (current_restriction) {
+        case none:
+            return sweepWithPolicy<AllParts>(smallest, largest, visit, algo);
+        case even_parts:
+            return sweepWithPolicy<EvenParts>(smallest, largest, visit, algo);
+        case odd_parts:
+            return sweepWithPolicy<OddParts>(smallest, largest, visit, algo);
+        case distinct_parts:
+            return sweepWithPolicy<DistinctParts>(smallest, largest, visit, algo);
+        case odd_distinct_parts:
+            return sweepWithPolicy<OddDistinctParts>(smallest, largest, visit, algo);
+        default:
+            //error handling: an unknown restriction generates nothing, as in makePlan()
+            return 0;
+    }
 }
 
 
-int poissonGenerationAttemptTwo(int size)
-{
-    //probability stuff we need
-    time_t seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator ((unsigned int)seed);
-    std::exponential_distribution<double> exp_distribution(1);
-    
-    //find the next interval divider in a geometric random variable z
-    double next_target = getAValue(1, size);
-    double end_of_curr_z = getZIntervalEnd(1, size);
-    double end_of_poisson = getEndOfPoisson(size);
-    double curr_pos = 0.0;
-    
-    //set up a partition we're building
-    RandomPartition* part = new RandomPartition();
-    part->partition_sizes.push_back(0);
-    
-    //curr interval tracks the intervals that comprise a geometric random variable
-    //curr z gives the multiplicity given by the geometric variable we're currently building
-    int curr_interval = 1;
-    int curr_z = 1;
-    
-    //stores the current value for an in progress zi
-    int running_geometric = 0;
-    //helps keep the geometric
-    int arrivals = 0;
-    
-    //stop when the poisson is done
-    bool poisson_complete = false;
-    
-    
-    //keep going for each z_i
-    for (;;)
+template <typename SizeType>
+template <typename Policy>
+SizeType BasicPartitionCreator<SizeType>::sweepWithPolicy(SizeType smallest, SizeType largest, const SweepVisitor& visit, sampleAlgorithms algo) {
+    SamplerState& state = own_state;
+    const SizeType a = Policy::first_part;
+    const int b = Policy::max_multiplicity;
+    
+    //sizes still waiting for their partition. Those without one in the class are never waited for.
+    std::vector<char> waiting(largest - smallest + 1, 0);
+    SizeType remaining = 0;
+    for (SizeType n = smallest; n <= largest; ++n)
     {
-        //go through intervals repeatedly adding by exponential amounts to the current position
-        for (;;)
+        SizeType bound = (largest_allowed_part > 0 && largest_allowed_part < n) ? largest_allowed_part : n;
+        if (hasPartition<Policy>(n, bound))
         {
-            //update current position
-            curr_pos+=exp_distribution(generator);
-            
-            //if the current position has exited the distribution, update the geometric and break out to abort.
-            if (curr_pos >= end_of_poisson) {
-                running_geometric += curr_interval * arrivals;
-                poisson_complete = true;
-                break;
-            }
-            
-            //if the current position has completed the z_i, update the geometric and break out to start the next one
-            if (curr_pos >= end_of_curr_z) {
-                running_geometric += curr_interval * arrivals;
-                break;
-            }
-            
-            //if the current distribution has exited the interval it's currently in:
-            if (curr_pos >= next_target) {
-                
-                //the geometric variable z_i is calculated as the sum of arrivals in yi times i.
-                //store arrivals times the current interval into the running geometric
-                
-                running_geometric += curr_interval * arrivals;
-                arrivals = 0;
-                curr_interval++;
-                
-                //find the next target position
-                double next_interval_length = getNextTargetLen(curr_z, curr_interval, size);
-                next_target += next_interval_length;
-                
-                //until we're back in an interval, just keep incrementing intervals
-                while  (next_target < curr_pos)
-                {
-                    curr_interval++;
-                    double next_interval_length = getNextTargetLen(curr_z, curr_interval, size);
-                    next_target += next_interval_length;
-                }
-                
-            }
-            
-            //We're either the first arrival of a new interval or another arrival in a current interval.
-            
-            //Either way, incrememnt our arrivals and continue this process of interval arrival counting
-            arrivals++;
+            waiting[n - smallest] = 1;
+            ++remaining;
         }
+    }
+    
+    //Every attempt is built with room for the largest size and draws every piece size any size may use. Whatever the
+    //Boltzmann parameter, an attempt that is accepted for size n is a uniform partition of n, so the parameter is only
+    //retuned as the sizes fill up, to keep the attempts near the smallest size still waiting.
+    Plan plan;
+    plan.goal_size = largest;
+    plan.restriction = current_restriction;
+    plan.largest_allowed_part = largest_allowed_part;
+    plan.largest_part = (largest_allowed_part > 0 && largest_allowed_part < largest) ? largest_allowed_part : largest;
+    plan.requested_algorithm = algo;
+    plan.algorithm = algo;
+    if (algo == poisson_process && b > 1)
+        plan.algorithm = div_conquer_deterministic;
+    plan.valid = true;
+    const bool divide_and_conquer = plan.algorithm != rejection_sample;
+    
+    Partition attempt(current_storage);
+    SizeType generated = 0;
+    SizeType lowest = smallest;
+    SizeType target = 0;
+    
+    //hands the attempt, with j pieces of size a for divide and conquer, to visit as a partition of n
+    auto deliver = [&](SizeType n, SizeType j) {
+        if (divide_and_conquer)
+            attempt.setMultiplicity(a, j);
+        //a dense partition covers exactly the piece sizes up to its size, and the attempt has none above n
+        if (attempt.storage == PartitionStorage::dense)
+            attempt.partition_sizes.resize(n + 1);
+        visit(n, attempt);
+        if (attempt.storage == PartitionStorage::dense)
+            attempt.partition_sizes.resize(largest + 1, 0);
+        waiting[n - smallest] = 0;
+        --remaining;
+        ++generated;
+        CREATOR_STATS(++state.stats.samples;)
+    };
+    
+    while (remaining > 0)
+    {
+        while (!waiting[lowest - smallest])
+            ++lowest;
         
-        
-        ////////
-        ///
-        ///     Above multiplicity loop completed
-        ///
-        ////////
-        
-        
-        //We just finished an interval or the poisson: Store the current geometric in the vector
-        part->partition_sizes.push_back(running_geometric);
-        
-        //if we finished the poisson, stop, we're done. Throw cleanup operations here if you have any.
-        if (poisson_complete) {
-            part->printPartition();
-            int i = part->sumPartition();
-            return i;
+        //aim about half a standard deviation of the attempt size, which grows like n^(3/4), above the lowest waiting size
+        if (lowest > target)
+        {
+            target = std::min(largest, lowest + (SizeType)(0.5*pow((double)lowest, 0.75)));
+            setAttemptConstants<Policy>(plan, target);
         }
         
-        //We will need to keep track of the z value preceding our new arrival
-        double prev_z_end = end_of_curr_z;
-        
-        //We're still going => we're not done with the poisson. increment the z interval once.
-        curr_z++;
-        end_of_curr_z += getZIntervalEnd(curr_z, size);
+        CREATOR_STATS(size_t storage_before = storageBytes(attempt); std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();)
+        SizeType drawn;
+        if (plan.algorithm == poisson_process)
+            drawn = poissonMultiplicities<Policy>(attempt, plan, state);
+        else
+            drawn = createPartitionGroups<Policy>(attempt, largest, divide_and_conquer ? a + Policy::part_step : a, plan.largest_part, plan.log_x, state);
+        ++state.attempt_count;
+        CREATOR_STATS(std::chrono::steady_clock::time_point generated_at = std::chrono::steady_clock::now(); SizeType generated_before = generated;)
         
-        //Until we're back in a z interval we've not reached the end of, any further increments implies empty intervals
-        //keep pushing zeros and incrementing the counter
-        double z_interval_len=1;
-        double flo = pow(2.,-50);
-        
-        while (end_of_curr_z <  curr_pos && z_interval_len >= flo) {
-            part->partition_sizes.push_back(0);
-            curr_z++;
-            prev_z_end = end_of_curr_z;
-            z_interval_len = getZIntervalEnd(curr_z, size);
-            end_of_curr_z += z_interval_len;
+        if (!divide_and_conquer)
+        {
+            if (drawn >= smallest && drawn <= largest && waiting[drawn - smallest])
+                deliver(drawn, 0);
         }
-        
-        //Reset the arrival count, this will be the first one in the new interval
-        arrivals = 1;
-        
-        //We need to find what interval in the current z_i we're starting in, though we know we will be in one since we're not
-        //past the end of the poisson and some z_i exists bigger than our current position.
-        curr_interval = 1;
-        
-        //New interval begins where the previous one ended.
-        next_target = prev_z_end + getNextTargetLen(curr_z, curr_interval, size);
-        
-        double next_interval_length = 1;
-        //increment current interval and next_target until we have a goal we're not past
-        while (next_target < curr_pos && next_interval_length >= flo)
+        else
         {
-            curr_interval++;
-            next_interval_length = getNextTargetLen(curr_z, curr_interval, size);
-            next_target += next_interval_length;
+            //The attempt is accepted for size drawn + j*a with the one uniform U < x^(j*a)/peak, the test
+            //divConquerDeterministic() makes, so it fills every waiting size in a run above drawn. For x < 1 the
+            //weight falls with j, and the first j that fails ends the run.
+            SizeType j = drawn >= smallest ? 0 : (smallest - drawn + a - 1)/a;
+            for (; drawn + j*a <= largest && (b == 0 || j <= b); ++j)
+            {
+                if (!(state.U < exp(j*a*plan.log_x - plan.log_peak)))
+                {
+                    if (plan.log_x <= 0)
+                        break;
+                    continue;
+                }
+                if (waiting[drawn + j*a - smallest])
+                    deliver(drawn + j*a, j);
+            }
         }
-        
-        //Last prep step: reset the running geometric so the next interval's sum begins at zero
-        running_geometric = 0;
+        CREATOR_STATS(recordAttempt(state, attempt, storage_before, start, generated_at, generated > generated_before);)
     }
+    return generated;
 }
 
 
-
-void PartitionCreator::poissonGeneration(int size)
-{
-    double c = 3.14159/sqrt(6);
-    double pi = 3.14159;
-    
-    //pick an x
-    double x1 = exp(-(c / (sqrt(size))));
-    double x2 = 1 - (c / (sqrt(size)));
-    double x = x1;
-    
-    
-    
-    double s=0.0; //get an interval length s
+template <typename SizeType>
+template <typename Policy>
+SizeType BasicPartitionCreator<SizeType>::createPartitionGroups(Partition& a, SizeType size, SizeType start_pos, SizeType largest_part, double log_x, SamplerState& state) const {
+    //use geometric distributions to generate numbers for partition groups here
     
-    //std::vector<double> poissonPositions;
+    //all multiplicities start at zero, including those below start_pos
+    a.reset(size);
     
-    time_t seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator ((unsigned int)seed);
     std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
+    state.U = uni_distribution(state.generator);
     
-    double a=uni_distribution(generator); //random variable
-    std::exponential_distribution<double> exp_distribution(1);
-    
-    
-    RandomPartition* part = new RandomPartition;
-    part->partition_sizes.push_back(0);
-    
-    
-    //debug: find out if we've done too many iterations in the function
-    int trapped=0;
-    
-
-    /*
-    //repeat until double precision breaks down but this is too slow so we do not use this
-    double j=1.0;
-    while (1/(j*j)!=0.0) {
-        s+=(1/(j*j))*((j*pow(x,j))/(1-pow(x,j))); //see formula 34
-        j++;
-    }*/
-    
-    //tight bound:
-    s = ((pi*pi)/6)*(x/(1-x));
-  
-    
-    double time = 0.0;
-    int arrivals = 0;
+    const SizeType step = Policy::part_step;
+    const int b = Policy::max_multiplicity;
     
-    double current_target = x/(1-x);
-    int index = 1;
+    //skip sampling needs the chance of a nonzero multiplicity to fall as piece sizes grow, which takes x < 1.
+    //Capped multiplicities have no block kernel and are always skip sampled when it applies.
+    if ((skip_sampling || b > 0) && log_x < 0)
+        return skipMultiplicities<Policy>(a, start_pos, largest_part, log_x, state);
+    SizeType total = 0;
     
-    //keep track of whether we're done
-    bool flag = true;
-    while (flag)
+    if (b > 0)
     {
-        double val = exp_distribution(generator);
-        time += val;
-        if (time > s) // if outside boundary stop
-            flag = false;
-        //once we complete the interval we were in: //DEBUG: No pushing if we're out of bounds
-        if (time > current_target && flag ==  true)
+        //P(multiplicity >= k) = (y^k - q)/(1 - q) for y = x^i and q = y^(b+1), inverted directly. Also holds for x > 1.
+        for (SizeType i = start_pos; i <= largest_part; i += step)
         {
-             //store the number of arrivals
-            part->partition_sizes.push_back(arrivals);
-            //reset arrivals
-            arrivals = 0;
-           
-            index++;
-             //calculate the next interval
-            double next_interval = pow(x,index)/(1-pow(x,index));
-            current_target+=next_interval;
-            
-            //run till we are in an interval:
-            while (current_target < time)
+            double l = i*log_x;
+            double q = exp((b + 1)*l);
+            SizeType mult_size = (SizeType)std::min((double)b, floor(log(1.0 - uni_distribution(state.generator)*(1.0 - q))/l));
+            if (mult_size != 0)
             {
-                part->partition_sizes.push_back(0);
-                index++;
-                //calculate the next interval
-                double next_interval = pow(x,index)/(1-pow(x,index));
-                current_target+=next_interval;
-                detectTrapped(trapped);
+                a.setMultiplicity(i, mult_size);
+                total += i*mult_size;
             }
         }
-        //poissonPositions.push_back(time);
-        if (flag == true)
-            //increment arrivals each time we're in the interval: //DEBUG: if statement, don't add past end
-            arrivals++;
+        return total;
     }
     
-    //if we still had arrivals queued before we ended, store them.
-    if (arrivals>0)
-        part->partition_sizes.push_back(arrivals);
-    
-    part->printPartition();
+    //draw the uniforms a block at a time and let the vector kernel compute floor(log(u)/(log_x*i)) for the whole block.
+    //Uniforms are taken from (0,1] so the logs stay finite.
+    const int block_size = 256;
+    double uniforms[block_size];
+    int multiplicities[block_size];
     
+    for (SizeType i = start_pos; i <= largest_part; i+=block_size*step) {
+        int count = (int)std::min((SizeType)block_size, (largest_part - i)/step + 1);
+        
+        for (int t = 0; t < count; ++t)
+            uniforms[t] = 1.0 - uni_distribution(state.generator);
+        
+        geometricMultiplicities(uniforms, count, i, step, log_x, multiplicities);
+        
+        for (int t = 0; t < count; ++t)
+        {
+            a.setMultiplicity(i + t*step, multiplicities[t]);
+            total += (i + t*step)*multiplicities[t];
+        }
+    }
+    return total;
 }
-//END DEBUG
 
 
+//Log of the chance that a piece size with x^i = e^l gets a nonzero multiplicity: y for unlimited multiplicities,
+//y(1 - y^b)/(1 - y^(b+1)) when they are capped at b
+template <typename Policy>
+static inline double logNonzeroChance(double l) {
+    if (Policy::max_multiplicity == 0)
+        return l;
+    return l + log(-expm1(Policy::max_multiplicity*l)) - log(-expm1((Policy::max_multiplicity + 1)*l));
+}
 
 
-RandomPartition* PartitionCreator::createPartitionGroups(int size,int start_pos) {
-    double c = 3.14159/sqrt(6);
-    double x = 1 - (c / (sqrt(size))); //to make the normal generation go faster, if there's a 2* in front of size, delete it
-    //to make odd parts faster, add a 2* in front of the size term.
-    
-    int iter_size = 1; //go one sized steps unless restrictions active
-    
-    if (current_restriction == activeRestrictions::even_parts)
+template <typename SizeType>
+template <typename Policy>
+SizeType BasicPartitionCreator<SizeType>::skipMultiplicities(Partition& a, SizeType start_pos, SizeType largest_part, double log_x, SamplerState& state) const {
+    std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
+    const SizeType step = Policy::part_step;
+    const int b = Policy::max_multiplicity;
+    
+    //Multiplicity i is nonzero with probability p_i, which only shrinks as i grows.
+    //Starting from index i, every later index is a candidate with probability p_i, so the distance to the
+    //next candidate is geometric. Keeping candidate j with probability p_j/p_i makes it nonzero with
+    //probability exactly p_j. The probabilities are kept as logs, x^i underflows long before i reaches largest_part.
+    //Uniforms are taken from (0,1] so the logs stay finite.
+    SizeType total = 0;
+    SizeType i = start_pos;
+    while (i <= largest_part)
     {
-        //it's an error if size is odd
-        if (size % 2 == 0)
-        {
-            std::cout << "Odd size was given to an even restricted partition's generation, this will never terminate. "
-            << std::endl << "Returning a size n partition" << std::endl;
-            
-            RandomPartition* a = new RandomPartition();
-            a->partition_sizes.resize(size+1);
-            for (int i = 1; i<=size-1;i++)
-                a->partition_sizes[i] = 0;
-            a->partition_sizes[size]=1;
-            return a;
-        }
+        double log_bound = logNonzeroChance<Policy>(i*log_x);
+        double skip = floor(log(1.0 - uni_distribution(state.generator))/log1p(-exp(log_bound)));
         
-        //start from one higher position if we don't have an even start
-        if ((start_pos % 2)!=0)
-            start_pos++;
-        iter_size = 2;
-    }
-    else if (current_restriction == activeRestrictions::odd_parts)
-    {
-        start_pos = 1;
-        iter_size = 2;
-    }
-    
-    //use geometric distributions to generate numbers for partition groups here
-    
-    RandomPartition* a = new RandomPartition();
-    
-    time_t seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator ((unsigned int)seed);
-    
-    a->partition_sizes.resize(size+1);
-    for(int i = 0; i < start_pos; i++){
-        a->partition_sizes[i] = 0;
+        //next candidate is past the end, every remaining multiplicity is zero. Also catches a bound that underflowed to zero.
+        if (!(skip <= (largest_part - i)/step))
+            break;
         
+        SizeType j = i + (SizeType)skip*step;
+        double l = j*log_x;
+        if (log(1.0 - uni_distribution(state.generator)) < logNonzeroChance<Policy>(l) - log_bound)
+        {
+            //a nonzero multiplicity is 1 plus a fresh copy of itself, capped at one less
+            SizeType mult_size = 1;
+            if (b == 0)
+                mult_size = 1 + floor(log(1.0 - uni_distribution(state.generator))/l);
+            else if (b > 1)
+                mult_size = 1 + (SizeType)std::min((double)(b - 1), floor(log(1.0 - uni_distribution(state.generator)*(1.0 - exp(b*l)))/l));
+            a.setMultiplicity(j, mult_size);
+            total += j*mult_size;
+        }
+        i = j + step;
     }
-    
+    return total;
+}
+
+
+
+//Draws from the logarithmic distribution P(k) = -y^k/(k log(1 - y)), y = e^l, by Kemp's LK algorithm.
+//Values above 2 cost a log, which only happens for y near 1.
+template <typename Engine>
+static long long logarithmicVariate(double l, Engine& generator) {
     std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
-    U = uni_distribution(generator);
-    
-    double y = x;
-    
-    //if(start_pos == 2)
-    //    y = x*x;
-    
-    double log_y = log(y);
-    
-    
-    for (int i = start_pos; i <= size; i+=iter_size) { //changing to iter size allows odd sampling
-    
-        //std::geometric_distribution<unsigned int> geo_distribution (1-y);
-        
-        int mult_size = floor(log(uni_distribution(generator))/(log_y*i));
-        a->partition_sizes[i] = mult_size;
-        
-        //y *= x; // add another factor to x.  I.e., x^i --> x^i+1)
-        
-    }
-    
-    return a;
+    double v = 1.0 - uni_distribution(generator);
+    if (v >= exp(l))
+        return 1;
+    double q = -expm1(log(-expm1(l))*(1.0 - uni_distribution(generator)));
+    if (v <= q*q)
+        return (long long)floor(1.0 + log(v)/log(q));
+    return v > q ? 1 : 2;
 }
 
 
-RandomPartition* PartitionCreator::createPartitionGroupsWithBernoulli(int size) {
-    double c = 3.14159/sqrt(6);
-    double x = 1 - (c / (2*sqrt(size)));
-    
-    int iter_size = 1; //go one sized steps unless restrictions active
-    
-    //use geometric distributions to generate numbers for partition groups here
-    
-    RandomPartition* a = new RandomPartition();
-    
-    time_t seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator ((unsigned int)seed);
-    
-    a->partition_sizes.resize(size+1);
-    a->partition_sizes[0] = 0;
-    
+template <typename SizeType>
+template <typename Policy>
+SizeType BasicPartitionCreator<SizeType>::poissonMultiplicities(Partition& a, const Plan& plan, SamplerState& state) const {
+    static_assert(Policy::max_multiplicity <= 1, "the Poisson process only covers unlimited and distinct multiplicities");
+    const SizeType size = plan.goal_size;
+    const SizeType start_pos = Policy::first_part + Policy::part_step;
+    const SizeType largest_part = plan.largest_part;
+    const double log_x = plan.log_x;
+    
+    //blocks need x < 1 to have finite length, the plan has none otherwise
+    if (!(log_x < 0))
+        return createPartitionGroups<Policy>(a, size, start_pos, largest_part, log_x, state);
+    
+    a.reset(size);
     std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
-    U = uni_distribution(generator);
-    
-    double xx = x;
-    
-    for(int i = 1; i <= size; i+=2) { //changing to iter size allows odd sampling
+    state.U = uni_distribution(state.generator);
+    
+    //A unit rate Poisson process on the concatenated blocks puts a Poisson number of arrivals in each block, independently.
+    //With block length -log(1 - y) and a logarithmic(y) variate per arrival, the multiplicity is a geometric(y) compound,
+    //exactly the law createPartitionGroups() draws. With length log(1 + y) and multiplicity 1 for any arrival, it is the
+    //distinct parts law. Arrivals come in increasing order, so the block search gallops forward from the last block hit.
+    const std::vector<double>& ends = plan.poisson_ends;
+    const SizeType step = Policy::part_step;
+    const size_t block_count = ends.size();
+    
+    SizeType total = 0;
+    size_t current = 0;
+    long long multiplicity = 0;
+    double t = 0.0;
+    while (block_count > 0)
+    {
+        t -= log(1.0 - uni_distribution(state.generator));
+        if (t >= ends[block_count - 1])
+            break;
+        
+        size_t k = current;
+        if (ends[k] <= t)
+        {
+            size_t low = k + 1;
+            size_t jump = 1;
+            while (low + jump < block_count && ends[low + jump - 1] <= t)
+            {
+                low += jump;
+                jump *= 2;
+            }
+            k = std::upper_bound(ends.begin() + low, ends.begin() + std::min(low + jump, block_count), t) - ends.begin();
+        }
         
-        //std::geometric_distribution<unsigned int> geo_distribution (1-y);
+        if (k != current)
+        {
+            if (multiplicity != 0)
+            {
+                SizeType i = start_pos + (SizeType)current*step;
+                a.setMultiplicity(i, (SizeType)multiplicity);
+                total += i*(SizeType)multiplicity;
+            }
+            current = k;
+            multiplicity = 0;
+        }
         
-        a->partition_sizes[i] = (uni_distribution(generator) < xx/ (1+xx)) ? 1 : 0;
-        xx *= x*x;
+        if (Policy::max_multiplicity == 1)
+            multiplicity = 1;
+        else
+            multiplicity += logarithmicVariate((start_pos + (SizeType)k*step)*log_x, state.generator);
+    }
+    if (multiplicity != 0)
+    {
+        SizeType i = start_pos + (SizeType)current*step;
+        a.setMultiplicity(i, (SizeType)multiplicity);
+        total += i*(SizeType)multiplicity;
     }
     
-    return a;
+    return total + skipMultiplicities<Policy>(a, plan.poisson_tail_start, largest_part, log_x, state);
 }
 
 
-
-void RandomPartition::printPartition(){
-    for(int i = 1; i<partition_sizes.size(); ++i){
-        std::cout << partition_sizes[i] << "  ";
+template <typename SizeType>
+void BasicRandomPartition<SizeType>::printPartition(){
+    if (storage == dense)
+    {
+        for(size_t i = 1; i<partition_sizes.size(); ++i){
+            std::cout << partition_sizes[i] << "  ";
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i<sparse_parts.size(); ++i){
+            std::cout << sparse_parts[i].first << "^" << sparse_parts[i].second << "  ";
+        }
     }
     std::cout << std::endl;
 }
 
-int RandomPartition::sumPartition(){
-    int size = 0;
-    for(int i = 1; i<partition_sizes.size(); ++i){
-        size += i*partition_sizes[i];
-    }
+template <typename SizeType>
+SizeType BasicRandomPartition<SizeType>::sumPartition(){
+    SizeType size = totalSize();
     std::cout << size << std::endl;
     return size;
 }
 
 
 
-RandomPartition* PartitionCreator::generateOddDistinct(int goal_size) {
-    RandomPartition* test_partition = nullptr;
+template <typename SizeType>
+BasicRandomPartition<SizeType>* BasicPartitionCreator<SizeType>::generateOddDistinct(SizeType goal_size, sampleAlgorithms algo) {
+    Partition* partition = new Partition(current_storage);
     
-    //rerun the algorithm until it works.
-    for (;;)
+    if (!generateOddDistinct(*partition, goal_size, algo))
     {
-        //keep a counter to compare the number of partitions with the result
-        int counter = 0;
-        
-        //delete the last partition allocation if one exists
-        if (test_partition!=nullptr)
-            delete test_partition;
-        
-        RandomPartition* test_partition = nullptr;
-        
-        //use uniform distributions to generate numbers for partition groups.
-        //partition_size[i] is the number of "i" sized partition groups.
-        //Note that we index from 1 to goal_size.
-        
-        test_partition = createPartitionGroupsWithBernoulli(goal_size);
-        
-        //count if we generated a partition of the correct size.
-        for(int i = 1; i < test_partition->partition_sizes.size(); ++i){
-            counter += i * test_partition->partition_sizes[i];
-        }
-        
-        //conclude if we hit the goal size
-        if (counter==goal_size) {
-            return test_partition;
-        }
+        delete partition;
+        return nullptr;
     }
+    return partition;
 }
 
 
-void appendToFile(std::string filename, RandomPartition* partition)
-{
-    std::ofstream filebuf;
-    filebuf.open((filename + ".txt"), std::ios::app);
-    if (filebuf.is_open())
-    {
-        for (int i = 1; i<partition->partition_sizes.size(); i++)
-        {
-            filebuf << partition->partition_sizes[i] << ",";
-        }
-        filebuf << "@" << std::endl;
-        filebuf.close();
-    }
+template <typename SizeType>
+bool BasicPartitionCreator<SizeType>::generateOddDistinct(Partition& test_partition, SizeType goal_size, sampleAlgorithms algo) {
+    return generateRandomPartition(test_partition, cachedPlan(goal_size, algo, odd_distinct_parts, 0));
 }
 
 
-
-//int main()
-/*
- {
-    int size = 17;
-    RandomPartition* test;
-    RandomPartition* test_2;
-    RandomPartition* test_odd_part;
-    RandomPartition* test_even_part;
-    PartitionCreator* PC = new PartitionCreator();
-    PartitionCreator* PC_restricted = new PartitionCreator();
-    
-    
-    PC->poissonGeneration(100);
-    PC_restricted->setRestriction(PartitionCreator::activeRestrictions::odd_parts);
-    
-    test = PC->generateRandomPartition(size, PartitionCreator::rejection_sample);
-    test_2 = PC->generateRandomPartition(size, PartitionCreator::div_conquer_deterministic);
-    test_odd_part = PC_restricted->generateRandomPartition(size, PartitionCreator::rejection_sample);
-    
-    PC_restricted->setRestriction(PartitionCreator::activeRestrictions::even_parts);
-    test_even_part = PC_restricted->generateRandomPartition(size, PartitionCreator::rejection_sample);
-    
-    
-    
-    test->printPartition();
-    test_2->printPartition();
-    test_odd_part->printPartition();
-    if (test_even_part!=nullptr)
-        test_even_part->printPartition();
-    
-    
-    std::cout << std::endl;
-     */
-    /*
-    //DEBUG
-    using namespace std;
-    
-    int j = 0;
-    int ctr = 0;
-    double runningSum = 0;
-    double runningAverage = 0;
-    PartitionCreator creator;
-    RandomPartition* part = nullptr;
-    
-    
-    for (int i = 0; i<100; i++)
-    {
-        part = creator.generateRandomPartition(10000);
-        appendToFile("random_partition_size_10000", part);
-        delete part;
-    }*/
-    
-    
-    /*
-    part = creator.oddDistinctGen(100000);
-    part->printPartition();
-    cout << endl;
-    part->sumPartition();
-    */
-    
-    /*
-    part = creator.generateRandomPartition(100000);
-    part->printPartition();
-    cout << endl;
-    part->sumPartition();
-    */
-    
-    
-    /*
-    while (j != 1000)
-    {
-        //j=100;
-        j = poissonGenerationAttemptTwo(1000);
-        ctr++;
-        runningSum += j;
-        runningAverage = runningSum/ctr;
-    }*/
+//Collects formatted text in a small stack buffer and hands it to the output string in chunks, which is much
+//faster than growing the string one character at a time
+template <typename SizeType>
+class CountFormatter {
+public:
+    CountFormatter(std::string& output) : buffer(output), used(0) {}
+    ~CountFormatter() { buffer.append(chunk, used); }
+    
+    //appends the decimal digits of a nonnegative value followed by a comma
+    void count(SizeType value) {
+        if (used > chunk_size - 24)
+            drain();
+        char digits[24];
+        int length = 0;
+        do
+        {
+            digits[length++] = '0' + (char)(value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (length > 0)
+            chunk[used++] = digits[--length];
+        chunk[used++] = ',';
+    }
     
-    /*
-    part = creator.generateRandomPartition(100000);
-    part->printPartition();*/
+    //appends "0," repeat times
+    void zeros(SizeType repeat) {
+        for (; repeat > 0; --repeat)
+        {
+            if (used > chunk_size - 2)
+                drain();
+            chunk[used++] = '0';
+            chunk[used++] = ',';
+        }
+    }
     
+    void text(const char* characters) {
+        drain();
+        buffer += characters;
+    }
     
-    //calculate size of each z interval for a partition of size 100
+private:
+    void drain() {
+        buffer.append(chunk, used);
+        used = 0;
+    }
     
-    /*
-    for (int i = 1; i<100; i++)
+    static const int chunk_size = 4096;
+    std::string& buffer;
+    char chunk[chunk_size];
+    int used;
+};
+
+
+template <typename SizeType>
+void formatPartition(std::string& buffer, const BasicRandomPartition<SizeType>& partition)
+{
+    CountFormatter<SizeType> formatter(buffer);
+    if (partition.storage == PartitionStorage::dense)
     {
-        double a = getZIntervalEnd(i, 100);
-        //double b = getZIntervalEnd(i+1, 100);
-        //cout << "a in z_" << i << " is " << getAValue(i, 100) << endl;
-        //cout << "a in z_" << i+1 << " is " << getAValue(i, 100) << endl;
-        //cout << b - a << endl;
+        for (size_t i = 1; i<partition.partition_sizes.size(); i++)
+            formatter.count(partition.partition_sizes[i]);
     }
-        */
-    
-    /*for (int j = 1; j<100; j+=10) //size
+    else
     {
-        for (int i = 1; i <100; i++) //current interval
+        //expand runs of zeros on the fly, never building the dense vector
+        SizeType written = 0;
+        for (size_t j = 0; j<partition.sparse_parts.size(); j++)
         {
-            cout << i << ", " << j << " " << getZIntervalEnd(i, j) << "   " << getEndOfPoisson(j) << endl;
+            formatter.zeros(partition.sparse_parts[j].first - written - 1);
+            formatter.count(partition.sparse_parts[j].second);
+            written = partition.sparse_parts[j].first;
         }
-    }*/
-    
-    /*
-    PartitionCreator* PC = new PartitionCreator();
-    for (int i = 0; i<1000; i++)
+        formatter.zeros(partition.totalSize() - written);
+    }
+    formatter.text("@\n");
+}
+
+
+template <typename SizeType>
+void appendToFile(std::string filename, BasicRandomPartition<SizeType>* partition)
+{
+    std::ofstream filebuf;
+    filebuf.open((filename + ".txt"), std::ios::app);
+    if (filebuf.is_open())
     {
-        PC->poissonGeneration(100);
+        std::string line;
+        formatPartition(line, *partition);
+        filebuf << line;
+        filebuf.close();
     }
-     */
-//}
+}
+
+//the samplers are instantiated here for the two supported size types only, so their code stays out of the header
+template class BasicRandomPartition<int>;
+template class BasicRandomPartition<long long>;
+template struct BasicSamplerPlan<int>;
+template struct BasicSamplerPlan<long long>;
+template class BasicPartitionCreator<int>;
+template class BasicPartitionCreator<long long>;
+template void appendToFile<int>(std::string filename, RandomPartition* partition);
+template void appendToFile<long long>(std::string filename, RandomPartition64* partition);
+template void formatPartition<int>(std::string& buffer, const RandomPartition& partition);
+template void formatPartition<long long>(std::string& buffer, const RandomPartition64& partition);
 
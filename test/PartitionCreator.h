@@ -11,7 +11,25 @@
 #define PartitionCreator_h
 
 #include <stdio.h>
+#include <functional>
+#include <memory>
 #include <vector>
+#include <random>
+#include <string>
+#include <utility>
+#ifdef PARTITION_CREATOR_STATS
+#include <chrono>
+#endif
+
+/** Storage layouts shared by every BasicRandomPartition, whatever its size type. */
+class PartitionStorage {
+public:
+    /** Available storage layouts. dense is default. */
+    enum storageTypes {dense, sparse};
+    
+    /** Layout currently used to hold the multiplicities. Only the matching container of the partition holds data. */
+    storageTypes storage;
+};
 
 /**
  A class representing a specific, randomized integer partition. A random partition represents a series of multiplicities, which is the count of pieces of a certain size in an integer partition.
@@ -23,90 +41,530 @@
  - 8,2,0,0,0,0,0,0,0,0 (8 pieces of size 1, 1 piece of size 2)
  - 0,0,0,0,0,0,0,0,0,1 (1 piece of size 10).
  
+ A partition is stored either densely, with one multiplicity per possible piece size in partition_sizes, or sparsely, with only the nonzero (piece size, multiplicity) pairs in sparse_parts. The sparse form of the second example above is (1,1),(4,1),(5,1).
+ Sparse storage needs memory proportional to the number of distinct piece sizes, which is of order sqrt(n) for a typical partition of n, instead of n.
+ 
+ SizeType is the integer type of piece sizes and multiplicities. RandomPartition uses int and RandomPartition64 uses long long, for partitions of 2^31 and more, which only fit in memory with sparse storage.
  */
-class RandomPartition {
+template <typename SizeType>
+class BasicRandomPartition : public PartitionStorage {
 public:
+    /** Constructor. Creates an empty partition using the given storage layout.
+     @param storageTypes Layout used for the multiplicities.*/
+    BasicRandomPartition(PartitionStorage::storageTypes = dense);
     
     /** Stores an integer partition as a series of increasingly large multiplicities. Index zero is garbage.
-     Indexes represent the number of pieces of that index's size in the partition.
+     Indexes represent the number of pieces of that index's size in the partition. Used by dense storage.
      */
-    std::vector<int>partition_sizes;
-    /** Prints out partition multiplicities. Prints to cout each multiplicity in partition_sizes, ignoring the zero index. */
+    std::vector<SizeType>partition_sizes;
+    /** Stores an integer partition as (piece size, multiplicity) pairs, sorted by increasing piece size and holding only nonzero multiplicities. Used by sparse storage. */
+    std::vector<std::pair<SizeType,SizeType> >sparse_parts;
+    
+    /** Empties the partition so multiplicities for piece sizes 1 to size can be set. Dense storage is resized and zeroed, sparse storage is simply cleared.
+     @param size Largest piece size that may be set afterwards.*/
+    void reset(SizeType size);
+    /** Returns the number of pieces of the given size. */
+    SizeType getMultiplicity(SizeType part) const;
+    /** Sets the number of pieces of the given size. Sparse storage is fastest when piece sizes are set in increasing order, which is how every sampler fills it.
+     @param part Piece size, between 1 and the size given to reset().
+     @param multiplicity Number of pieces of that size.*/
+    void setMultiplicity(SizeType part, SizeType multiplicity);
+    /** Returns the total size of all combined pieces without printing anything. */
+    SizeType totalSize() const;
+    
+    /** Prints out partition multiplicities. Dense storage prints to cout each multiplicity in partition_sizes, ignoring the zero index. Sparse storage prints each nonzero multiplicity as size^multiplicity. */
     void printPartition();
     /** Sums all partition multiplicities. Ignores the zero index and returns the total size of all combined pieces. */
-    int sumPartition();
+    SizeType sumPartition();
+};
+
+/** Partition with int piece sizes, enough for partitions below 2^31. */
+typedef BasicRandomPartition<int> RandomPartition;
+/** Partition with 64 bit piece sizes. */
+typedef BasicRandomPartition<long long> RandomPartition64;
+
+/** Appends a partition to filename.txt as one line of comma separated multiplicities followed by an @. Sparse partitions are written in the same dense layout, with one entry for every piece size up to the partition's total size.
+ Opens and closes the file on every call, so prefer PartitionWriter when writing many partitions.
+ @param filename File name without the .txt extension.
+ @param partition Partition to append.
+ @see PartitionWriter*/
+template <typename SizeType>
+void appendToFile(std::string filename, BasicRandomPartition<SizeType>* partition);
+
+/** Appends the line appendToFile() writes for a partition, including the trailing @ and newline, to a string.
+ @param buffer String the line is appended to.
+ @param partition Partition to format.*/
+template <typename SizeType>
+void formatPartition(std::string& buffer, const BasicRandomPartition<SizeType>& partition);
+
+/** Random number engine used for all partition generation. Every SamplerState owns one, seeded once on construction or through seed(). */
+typedef std::mt19937_64 RandomEngine;
+
+/**
+ Sampling statistics of a PartitionCreator, to see where the time of a slow generateRandomPartition() call went.
+ 
+ Statistics are only collected when the project is built with PARTITION_CREATOR_STATS defined (DEFINES += PARTITION_CREATOR_STATS in qmake). Without it the instrumentation is not compiled at all, creators and sampler states carry no statistics, and BasicPartitionCreator::stats() returns an all zero object whose enabled field is false.
+ 
+ Time spent drawing multiplicities (createPartitionGroups(), skip sampling or the Bernoulli draws) is reported separately from time spent deciding whether to accept the attempt. Allocation counts the bytes by which the storage of the partitions attempts are built in had to grow, which is zero in the steady state of a reused output.
+ */
+struct PartitionCreatorStats {
+    /** Constructor. All counts zero. */
+    PartitionCreatorStats();
+    
+    /** Whether this build collects statistics. */
+    bool enabled;
+    /** Partitions returned. */
+    unsigned long long samples;
+    /** Candidate partitions drawn, including rejected ones. Self similar divide and conquer draws one per round attempt. */
+    unsigned long long attempts;
+    /** Attempts that were accepted. */
+    unsigned long long accepted_attempts;
+    /** Seconds spent drawing multiplicities. */
+    double generation_seconds;
+    /** Seconds spent in acceptance checks. */
+    double acceptance_seconds;
+    /** Bytes of partition storage allocated while building attempts. */
+    unsigned long long allocation_bytes;
+    /** Histogram of the deficit k left for the pieces divide and conquer with deterministic second half leaves out of its attempts. Entry 0 counts k = 0 and entry b counts 2^(b-1) <= k < 2^b. */
+    std::vector<unsigned long long> deficit_histogram;
+    /** Divide and conquer attempts whose other pieces already exceeded the goal size, a negative k. */
+    unsigned long long negative_deficits;
+    
+    /** Returns accepted_attempts/attempts, or zero before any attempt. */
+    double acceptanceRate() const;
+    /** Adds a deficit to the histogram. */
+    void addDeficit(long long k);
+    /** Adds the counts of other to these. */
+    void merge(const PartitionCreatorStats& other);
+    /** Resets every count to zero. */
+    void clear();
+    /** Returns the statistics as a JSON object. */
+    std::string toJson() const;
 };
 
-/** A class which creates partitions of a desired size and with desired restrictions.*/
-class PartitionCreator {
+/**
+ Everything one sampling call changes: the random engine, the geometric variable, the attempt counter and, when built with PARTITION_CREATOR_STATS, the statistics. The const generateRandomPartition(Partition&, const BasicSamplerPlan&, SamplerState&) keeps all of its state in one of these, so one creator and one plan can serve any number of threads at once, each with its own SamplerState, without locking. A state is not shared between threads itself.
+ */
+struct SamplerState {
+    /** Constructor. Seeds the engine nondeterministically. */
+    SamplerState();
+    /** Constructor. Seeds the engine as seed() does. */
+    SamplerState(unsigned long long seed, unsigned long long stream = 0);
+    
+    /** Reseeds the engine. States seeded with the same seed but different streams produce independent sequences.
+     @param seed Seed value.
+     @param stream Stream index, used to split one seed into several independent engines.*/
+    void seed(unsigned long long seed, unsigned long long stream = 0);
+    
+    /** Random engine of every draw. */
+    RandomEngine generator;
+    /** Geometric random variable. */
+    double U;
+    /** Candidate partitions drawn with this state, including rejected ones. */
+    unsigned long long attempt_count;
+    /** Optional check called before every attempt, including every round attempt of self similar divide and conquer. Once it returns true the sampling call gives up, leaving its output incomplete, and generateRandomPartition() returns false. It lets another thread abandon a long sample, for instance through an atomic flag. exact_table never rejects and only checks once its sample is complete. Empty by default. */
+    std::function<bool()> cancel_check;
+    
+    /** Returns whether cancel_check is set and returns true. */
+    bool cancelled() const;
+#ifdef PARTITION_CREATOR_STATS
+    /** Statistics of the draws with this state. */
+    PartitionCreatorStats stats;
+#endif
+};
+
+/** Algorithm and restriction choices shared by every BasicPartitionCreator, whatever its size type. */
+class PartitionCreatorBase {
 public:
-    /** Constructor. Initializes the partition creator to have no active restrictions.*/
-    PartitionCreator();
-    /** Valid partition creation algorithms. self_similar_div_conquer is presently nonfunctional and should not be used.*/
-    enum sampleAlgorithms {rejection_sample, div_conquer_deterministic, self_similar_div_conquer};
-    /** Valid restrictions. None is default. even_parts is presently nonfunctional and should not be used*/
-    enum activeRestrictions {none, even_parts, odd_parts};
+    /** Valid partition creation algorithms. self_similar_div_conquer and exact_table only support the none restriction without a largest part and fall back to div_conquer_deterministic for others.*/
+    enum sampleAlgorithms {rejection_sample, div_conquer_deterministic, self_similar_div_conquer, exact_table, poisson_process};
+    /** Valid restrictions. None is default. Each one selects a restriction policy from RestrictionPolicy.h, which the samplers are compiled for.*/
+    enum activeRestrictions {none, even_parts, odd_parts, distinct_parts, odd_distinct_parts};
+};
+
+class BigCount;
+template <typename SizeType>
+class BasicPartitionStatistics;
+
+/**
+ Everything a sampler derives from its size, restriction and algorithm before drawing anything: the Boltzmann parameter, the acceptance constants and the lookup tables. Made by BasicPartitionCreator::makePlan() and used by BasicPartitionCreator::generateRandomPartition(Partition&, const BasicSamplerPlan&), so many samples pay for the setup once.
+ 
+ Sampling never changes a plan, so one plan can be shared by any number of creators and threads. Creators also keep the plan of their last generateRandomPartition() call by size, which makes repeated calls with the same size just as cheap.
+ 
+ SizeType is the integer type of sizes, as in BasicRandomPartition.
+ */
+template <typename SizeType>
+struct BasicSamplerPlan {
+    /** Constructor. An invalid plan, which generates nothing. */
+    BasicSamplerPlan();
+    
+    /** Size of the generated partitions. */
+    SizeType goal_size;
+    /** Restriction the plan is for. */
+    PartitionCreatorBase::activeRestrictions restriction;
+    /** Upper bound on piece sizes the plan was asked for, 0 for none. */
+    SizeType largest_allowed_part;
+    /** Largest piece size the attempts draw, goal_size or the smaller bound. */
+    SizeType largest_part;
+    /** Algorithm the plan was asked for. */
+    PartitionCreatorBase::sampleAlgorithms requested_algorithm;
+    /** Algorithm that runs, which is divide and conquer where the requested one does not support the restriction. */
+    PartitionCreatorBase::sampleAlgorithms algorithm;
+    /** Whether goal_size has a partition under the restriction. Invalid plans generate nothing. */
+    bool valid;
+    
+    /** Log of the Boltzmann parameter x of the attempts. For self similar divide and conquer, that of its first round. */
+    double log_x;
+    /** Divide and conquer: log of the largest acceptance weight of a deficit. Self similar divide and conquer: log of the largest weight of an even half in its first round. */
+    double log_peak;
+    /** Poisson process: end of the block of every piece size, from the second allowed one on, up to poisson_tail_start. */
+    std::vector<double> poisson_ends;
+    /** Poisson process: first piece size left to skip sampling. */
+    SizeType poisson_tail_start;
+    /** Exact table: sum of the divisors of every s up to goal_size. */
+    std::vector<unsigned int> divisor_sums;
+    /** Exact table: partition counts up to goal_size, when it is past the compile time table. */
+    std::shared_ptr<const std::vector<BigCount> > partition_counts;
+    /** Divide and conquer for distinct odd parts: number m of small odd piece sizes 1, 3, ..., 2m-1 in each nested block left out of the attempts, halving from the largest down to 0. Empty for other plans. */
+    std::vector<int> small_odd_blocks;
+    /** Divide and conquer for distinct odd parts: for each block m of small_odd_blocks in turn, log of the number of sets of its piece sizes with sum j, for j from 0 to m^2. */
+    std::vector<double> small_odd_log_counts;
+    /** Divide and conquer for distinct odd parts: log of the largest weight count(j)*x^j of each block. */
+    std::vector<double> small_odd_log_peaks;
+};
+
+/** Plan for PartitionCreator. */
+typedef BasicSamplerPlan<int> SamplerPlan;
+/** Plan for PartitionCreator64. */
+typedef BasicSamplerPlan<long long> SamplerPlan64;
+
+/** A class which creates partitions of a desired size and with desired restrictions.
+ 
+ SizeType is the integer type of sizes, as in BasicRandomPartition. PartitionCreator uses int, which keeps the dense samplers and their block kernel on 32 bit arithmetic, and PartitionCreator64 uses long long, for sizes of 2^31 and more with self similar divide and conquer, skip sampling and sparse storage. exact_table falls back to self_similar_div_conquer beyond int sizes, as its count table could not be built that large anyway.
+ 
+ The const members never change the creator, so one creator can serve a whole thread pool without locking: share a plan from makePlan(), which takes its restriction per call if needed, and give every thread its own SamplerState and output for generateRandomPartition(Partition&, const Plan&, SamplerState&). The other generating members use the creator's own engine and last plan, and must not be called from several threads at once.
+ */
+template <typename SizeType>
+class BasicPartitionCreator : public PartitionCreatorBase {
+public:
+    /** Partition type produced by this creator. */
+    typedef BasicRandomPartition<SizeType> Partition;
+    /** Plan type used by this creator. */
+    typedef BasicSamplerPlan<SizeType> Plan;
+    /** Receiver of the partitions of generateSweep(), called with a size and its partition. */
+    typedef std::function<void(SizeType, const Partition&)> SweepVisitor;
+    /** Statistics type filled by generateStatistics(). */
+    typedef BasicPartitionStatistics<SizeType> Statistics;
+    
+    /** Constructor. Initializes the partition creator to have no active restrictions and a nondeterministically seeded random engine.*/
+    BasicPartitionCreator();
     
     /** Generates a random partition of a given size. One may choose the algorithm to use for this generation.
-     Rejection sample is effective within till around 10^5 in size at which point it will likely no longer terminate, and Divide and conquer with deterministic second half will work until around 10^8 in size, after which it should still work, albeit slowly.
-     
-     Nondefault restrictions desired should be made active before running this using the setRestriction function, as this effects how the partition is generated.
+     Rejection sample is effective within till around 10^5 in size at which point it will likely no longer terminate, and Divide and conquer with deterministic second half will work until around 10^8 in size, after which it should still work, albeit slowly. Self similar divide and conquer has sublinear expected cost and is meant for sizes beyond that, preferably with sparse storage.
+     Exact table never rejects and is meant for small and medium sizes, up to around 10^5. It needs the exact partition counts up to size, which are built once per process and shared by every creator and thread.
+     Poisson process is divide and conquer with deterministic second half, drawing every attempt from a single Poisson arrival stream, so an attempt costs about sqrt(size) random numbers rather than size. It reaches the same sizes as Divide and conquer, faster, and keeps a table of about 11*sqrt(size) doubles in its plan.
      
-     If one wants odd distinct partition generation, generate using generateOddDistinct instead.
+     Nondefault restrictions desired should be made active before running this using the setRestriction function, as this effects how the partition is generated. Nothing is generated if size has no partition under the restriction, such as an odd size with even_parts.
      @param size The desired partition size.
      @param sampleAlgorithms The desired algorithm to run.
      @see setRestriction()
      @see generateOddDistinct()
      */
-    RandomPartition* generateRandomPartition(int size, enum PartitionCreator::sampleAlgorithms = div_conquer_deterministic);
+    Partition* generateRandomPartition(SizeType size, sampleAlgorithms = div_conquer_deterministic);
+    
+    /** Generates a random partition of a given size into a caller supplied partition, keeping that partition's storage layout. Every rejected attempt is built inside the output's own storage, so once the output has held a partition of this size, further calls and attempts do no heap allocation. Reuse one output across calls to take advantage of this.
+     @param output Partition to fill. Its previous contents are overwritten.
+     @param size The desired partition size.
+     @param sampleAlgorithms The desired algorithm to run.
+     @return false if nothing was generated, under the same conditions where the pointer version returns nullptr.
+     @see generateRandomPartition()
+     */
+    bool generateRandomPartition(Partition& output, SizeType size, sampleAlgorithms = div_conquer_deterministic);
+    
+    /** Generates a random partition of a given size and returns it by value, using the storage layout set through setStorage().
+     @param size The desired partition size.
+     @param sampleAlgorithms The desired algorithm to run.
+     @return The partition, or an empty partition if nothing was generated.
+     @see generateRandomPartition()
+     */
+    Partition generatePartition(SizeType size, sampleAlgorithms = div_conquer_deterministic);
+    
+    /** Computes everything a sampler needs before drawing for a size, under the active restriction, once. The plan can then be passed to generateRandomPartition() for any number of samples, by this creator or any other, from any thread.
+     @param size The desired partition size.
+     @param sampleAlgorithms The desired algorithm to run.
+     @return The plan. It is invalid if size has no partition under the restriction, or if the restriction or algorithm is unknown.
+     @see BasicSamplerPlan*/
+    Plan makePlan(SizeType size, sampleAlgorithms = div_conquer_deterministic) const;
+    
+    /** Makes the plan for a size under a given restriction, whatever restriction is active, so threads sharing a creator can each use their own.
+     @param size The desired partition size.
+     @param algo The desired algorithm to run.
+     @param restriction Restriction of the plan.
+     @param largest_allowed Upper bound on piece sizes, 0 for none.
+     @return The plan. It is invalid if size has no partition under the restriction, or if the restriction or algorithm is unknown.
+     @see setRestriction()*/
+    Plan makePlan(SizeType size, sampleAlgorithms algo, activeRestrictions restriction, SizeType largest_allowed) const;
+    
+    /** Generates a random partition from a plan made by makePlan(), into a caller supplied partition, keeping that partition's storage layout. The plan's restriction is used, not the active one.
+     @param output Partition to fill. Its previous contents are overwritten.
+     @param plan Plan of the size, restriction and algorithm.
+     @return false if the plan is invalid, and nothing was generated.
+     @see makePlan()*/
+    bool generateRandomPartition(Partition& output, const Plan& plan);
+    
+    /** Generates a random partition from a plan with a caller supplied sampler state, leaving this creator unchanged. Any number of threads may call it on one creator at once, each with its own state and output, as long as none of them changes the creator's settings meanwhile. The creator's skip sampling setting is used.
+     @param output Partition to fill. Its previous contents are overwritten.
+     @param plan Plan of the size, restriction and algorithm.
+     @param state Engine and counters of the calling thread. Its attempts and statistics are added to it, not to the creator's.
+     @return false if the plan is invalid, and nothing was generated, or if the state's cancel_check stopped the call, leaving output incomplete.
+     @see SamplerState*/
+    bool generateRandomPartition(Partition& output, const Plan& plan, SamplerState& state) const;
+    
+    /** Generates a random partition of a given size and restriction with a caller supplied sampler state, making the plan for this call alone. Prefer a plan shared between calls when sampling one size many times.
+     @param output Partition to fill. Its previous contents are overwritten.
+     @param size The desired partition size.
+     @param algo The desired algorithm to run.
+     @param restriction Restriction of the partition, whatever restriction is active.
+     @param largest_allowed Upper bound on piece sizes, 0 for none.
+     @param state Engine and counters of the calling thread.
+     @return false if nothing was generated.
+     @see generateRandomPartition(Partition&, const Plan&, SamplerState&)*/
+    bool generateRandomPartition(Partition& output, SizeType size, sampleAlgorithms algo, activeRestrictions restriction, SizeType largest_allowed, SamplerState& state) const;
+    
+    /** Generates many random partitions of a given size in parallel. Samples are handed out to a pool of worker threads, which share this creator and its plan and each own a SamplerState with a random stream split off from this creator's engine, so the results are statistically independent of each other.
+     
+     Worker streams are derived from a single draw of this creator's engine, so a batch is reproducible after seed() up to the order in which workers pick up samples.
+     @param size The desired partition size.
+     @param count The number of partitions to generate.
+     @param sampleAlgorithms The desired algorithm to run.
+     @param threads Number of worker threads, 0 uses every hardware thread.
+     @return count partitions, owned by the caller, or an empty vector if size or count is invalid or size has no partition under the restriction.
+     @see generateRandomPartition()
+     */
+    std::vector<Partition*> generateBatch(SizeType size, int count, sampleAlgorithms = div_conquer_deterministic, int threads = 0);
+    
+    /** Generates many random partitions of a given size in parallel and adds each one to statistics as soon as it is drawn, keeping none of them, so memory does not grow with count. Workers are set up as in generateBatch(), each with one reused partition and its own statistics, which are merged into output once every worker is done.
+     
+     Every worker draws a fixed share of count, so the statistics are reproducible after seed() for a given number of threads.
+     @param output Statistics the partitions are added to. Partitions already added to it are kept, and its tracking bound is used by every worker.
+     @param size The desired partition size.
+     @param count The number of partitions to generate.
+     @param sampleAlgorithms The desired algorithm to run.
+     @param threads Number of worker threads, 0 uses every hardware thread.
+     @return The number of partitions added, 0 if size has no partition under the restriction.
+     @see BasicPartitionStatistics
+     @see generateBatch()
+     */
+    unsigned long long generateStatistics(Statistics& output, SizeType size, unsigned long long count, sampleAlgorithms = div_conquer_deterministic, int threads = 0);
+    
+    /** Generates one random partition of every size from smallest to largest under the active restriction, sharing attempts between the sizes, and hands each one to visit as soon as it is found, in no particular order. Sizes without a partition under the restriction are left out.
+     
+     Divide and conquer and the Poisson process test every attempt against all the sizes it can reach by adding pieces of the smallest allowed size, and fill all of those it is accepted for. Each size gets a uniformly random partition, as from generateRandomPartition(), but partitions of nearby sizes may come from the same attempt and then share all their other pieces, so they are not independent of each other. Rejection sampling fills the one size an attempt hits, so its partitions are independent. Self similar divide and conquer and the exact table draw nothing several sizes could share, and generate every size separately.
+     
+     A sweep over many neighbouring sizes needs far fewer attempts in total than generating them one by one, and no plan per size.
+     @param smallest Smallest size.
+     @param largest Largest size.
+     @param visit Called with every size and its partition, which is only valid during the call. Partitions have the storage layout set through setStorage().
+     @param sampleAlgorithms The desired algorithm to run.
+     @return The number of sizes generated.
+     @see generateRandomPartition()
+     */
+    SizeType generateSweep(SizeType smallest, SizeType largest, const SweepVisitor& visit, sampleAlgorithms = div_conquer_deterministic);
+    
+    /** Reseeds the random engine. Creators seeded with the same seed but different streams produce independent sequences.
+     @param seed Seed value.
+     @param stream Stream index, used to split one seed into several independent engines.*/
+    void seed(unsigned long long seed, unsigned long long stream = 0);
     
     /** Sets restrictions to be used in generateRandomPartition().
      @param activeRestrictions Makes this parameter the active restriction, none being default. 
+     @param largest_part Upper bound on piece sizes under any restriction, 0 for none.
      @see generateRandomPartition()*/
-    void setRestriction(enum PartitionCreator::activeRestrictions);
+    void setRestriction(activeRestrictions, SizeType largest_part = 0);
+    
+    /** Sets the storage layout of partitions returned by the samplers. Dense is default. Sparse keeps only nonzero multiplicities, so memory per sample follows the number of distinct piece sizes instead of the partition size.
+     @param storageTypes Layout of generated partitions.
+     @see RandomPartition*/
+    void setStorage(PartitionStorage::storageTypes);
+    
+    /** Turns skip sampling on or off, default off. With skip sampling the samplers jump straight from one nonzero multiplicity to the next instead of drawing every index, so an attempt costs about the number of distinct piece sizes rather than the partition size. Generated partitions have the same distribution either way. Best combined with sparse storage.
+     @param enabled Whether to use skip sampling.
+     @see setStorage()*/
+    void setSkipSampling(bool enabled);
+    
+    /** Returns the number of candidate partitions drawn since construction, including rejected ones, counting the attempts of generateBatch() workers too. Divided by the number of samples generated, it gives the mean attempts per accepted sample. */
+    unsigned long long attemptCount() const;
     
-    /** Generates odd distinct partitions. Odd distinct partitions have only either 1's or 0's in odd indexed slots. Restrictions do not affect this function.
-     @param goal_size The desired partition size.*/
-    RandomPartition* generateOddDistinct(int goal_size);
+    /** Returns the sampling statistics gathered since construction or the last resetStats(), including those of generateBatch() workers. All zero unless built with PARTITION_CREATOR_STATS.
+     @see PartitionCreatorStats*/
+    const PartitionCreatorStats& stats() const;
+    /** Clears the sampling statistics. */
+    void resetStats();
+    
+    /** Generates odd distinct partitions. Odd distinct partitions have only either 1's or 0's in odd indexed slots. The same as generateRandomPartition() with the odd_distinct_parts restriction, whatever restriction is active.
+     rejection_sample draws every odd piece size and retries until the sizes sum to goal_size, which takes of order goal_size^(3/4) attempts. poisson_process leaves the piece of size 1 out of the attempts and accepts a deficit of 0 or 1, about doubling the acceptance rate. Any other algorithm uses divide and conquer over a block of small odd piece sizes that grows with goal_size, see oddDistinctDivConquer(), which keeps the attempts per sample at about 2 up to sizes near 10^6. Past that its block stops growing and they rise as about goal_size^(3/4) again, to a few dozen at 10^7.
+     Either way an attempt only draws about as many random numbers as the partition has parts.
+     @param goal_size The desired partition size.
+     @param algo Sampling algorithm, see above.
+     @return The partition, or nullptr if goal_size has no odd distinct partition.*/
+    Partition* generateOddDistinct(SizeType goal_size, sampleAlgorithms algo = div_conquer_deterministic);
+    
+    /** Generates odd distinct partitions into a caller supplied partition, reusing its storage for every attempt.
+     @param output Partition to fill. Its previous contents are overwritten.
+     @param goal_size The desired partition size.
+     @param algo Sampling algorithm, see generateOddDistinct(SizeType, sampleAlgorithms).
+     @return false if nothing was generated.
+     @see generateRandomPartition(Partition&, SizeType, sampleAlgorithms)*/
+    bool generateOddDistinct(Partition& output, SizeType goal_size, sampleAlgorithms algo = div_conquer_deterministic);
     
-    /** Defunct poisson generation attempted implementation. A non-class updated attempt which works despite asymptotic overshoot in partitionCreator.cpp exists
-     @param size Desired partition size.*/
-    void poissonGeneration(int size);
 private:
+    /**
+     Fills in the plan's constants for one restriction policy. The plan's size, restriction, bound and requested algorithm are set already.
+     @param plan Plan to complete
+     @see RestrictionPolicy.h
+     */
+    template <typename Policy>
+    void fillPlan(Plan& plan) const;
+    /**
+     Returns last_plan, made anew unless it is already for these parameters.
+     @see makePlan()
+     */
+    const Plan& cachedPlan(SizeType size, sampleAlgorithms algo, activeRestrictions restriction, SizeType largest_allowed);
+    /**
+     Runs the plan's sampling algorithm for one restriction policy.
+     @param output Partition to fill
+     @param plan Valid plan for the policy
+     @see RestrictionPolicy.h
+     */
+    template <typename Policy>
+    void generateWithPolicy(Partition& output, const Plan& plan, SamplerState& state) const;
+    /**
+     Runs generateSweep() for one restriction policy, with rejection sampling, divide and conquer or the Poisson process.
+     @see generateSweep()
+     */
+    template <typename Policy>
+    SizeType sweepWithPolicy(SizeType smallest, SizeType largest, const SweepVisitor& visit, sampleAlgorithms algo);
     /** 
      Rejection sample algorithm for partition generation.
-     @param goal_size Size of partition to generate
+     @param output Partition the attempts are built in, holds the result on return
+     @param plan Plan of the size
+     @param state Engine and counters of the call
      */
-    RandomPartition* rejectionSample(int goal_size);
+    template <typename Policy>
+    void rejectionSample(Partition& output, const Plan& plan, SamplerState& state) const;
     /**
      Divide and conquer with deterministic second half algorithm for partition generation.
-     @param goal_size Size of partition to generate
+     The multiplicity of the smallest allowed piece size is left out of the attempts and decided from the deficit they leave, accepted with probability proportional to its chance under the Boltzmann law.
+     @param output Partition the attempts are built in, holds the result on return
+     @param plan Plan of the size
+     @param state Engine and counters of the call
+     @param poisson_attempts Whether attempts are drawn by poissonMultiplicities() instead of createPartitionGroups()
+     */
+    template <typename Policy>
+    void divConquerDeterministic(Partition& output, const Plan& plan, SamplerState& state, bool poisson_attempts = false) const;
+    /**
+     Divide and conquer for distinct odd parts, which makePlan() picks over divConquerDeterministic() for that restriction.
+     The attempts leave out the small odd piece sizes 1, 3, ..., 2m-1 of the plan's largest block, and the deficit is accepted with probability proportional to the number of their sets that fill it, times x^deficit. The block grows with goal_size, so the acceptance rate does not fall with it up to the block limit of 1000 piece sizes, whose count table takes about 8 MB of the plan and 0.3 s to build. The set is then drawn the same way one block down, from halves of the block that is left, and only the attempts for the outer block count in the attempt counter.
+     @param output Partition the attempts are built in, holds the result on return
+     @param plan Plan of the size, with small_odd_blocks filled
+     @param state Engine and counters of the call
      */
-    RandomPartition* divConquerDeterministic(int goal_size);
+    void oddDistinctDivConquer(Partition& output, const Plan& plan, SamplerState& state) const;
     /**
-     In progress non-functional self similar divide and conquer algorithm for partition generation.
-     @param goal_size Size of partition to generate
+     Self similar divide and conquer algorithm for partition generation.
+     The multiplicities of odd sized pieces are sampled with skip sampling and accepted with probability proportional to the chance that the even sized pieces make up the rest. Given their total 2m, the even sized pieces are exactly twice a uniform partition of m, so the algorithm repeats on m with piece sizes doubled, for about log2(goal_size) rounds.
+     Only supports the none restriction without a largest part, makePlan() picks divConquerDeterministic() for others.
+     @param output Partition to fill, holds the result on return
+     @param plan Plan of the size
+     @param state Engine and counters of the call
      */
-    RandomPartition* selfSimilarDivConquer(int goal_size);
+    void selfSimilarDivConquer(Partition& output, const Plan& plan, SamplerState& state) const;
     /**
      Generates multiplicities values for a partition. These values are not guaranteed to sum to the desired size, though they will statistically be rather close
-     Restrictions affect the way that this function operates.
+     Piece size i gets multiplicity k with probability proportional to x^(i*k), for k up to the policy's max_multiplicity.
+     @param a Partition to overwrite with the multiplicities, keeping its storage layout
      @param size Aimed for generation size
-     @param start_pos Dictates multiplicity where generation of multiplicities begins. 
+     @param start_pos Dictates multiplicity where generation of multiplicities begins. Must be an allowed piece size.
+     @param largest_part Last piece size drawn
+     @param log_x Log of the Boltzmann parameter x
+     @param state Engine of the call
+     @return Sum of the drawn pieces
      @see setRestriction()
      */
-    RandomPartition* createPartitionGroups(int size, int start_pos);
+    template <typename Policy>
+    SizeType createPartitionGroups(Partition& a, SizeType size, SizeType start_pos, SizeType largest_part, double log_x, SamplerState& state) const;
     /**
-     Uses bernoulli generation and modified rejection sample in order to produce distinct odd parts multiplicities. Unaffected by restrictions. Not guaranteed to be equal to the target size.
-     @param size Aimed for generation size
+     Skip sampling of multiplicities. Sets the multiplicity of every allowed piece size from start_pos up to largest_part, drawing only the nonzero ones. Other multiplicities are left untouched.
+     Needs x < 1, so that the chance of a nonzero multiplicity falls as the piece size grows.
+     @param a Partition receiving the nonzero multiplicities
+     @param start_pos First piece size
+     @param largest_part Last allowed piece size
+     @param log_x Log of the Boltzmann parameter x
+     @param state Engine of the call
+     @return Sum of the drawn pieces
+     @see setSkipSampling()
+     */
+    template <typename Policy>
+    SizeType skipMultiplicities(Partition& a, SizeType start_pos, SizeType largest_part, double log_x, SamplerState& state) const;
+    /**
+     Draws the same multiplicities as createPartitionGroups() from one unit rate Poisson process. Every allowed piece size owns a block of the time line, and its multiplicity follows from the arrivals that land in it. Piece sizes too large to expect arrivals are skip sampled.
+     Only for unlimited multiplicities and multiplicities capped at 1. Draws the piece sizes divide and conquer draws, from the second allowed one on.
+     @param a Partition to overwrite with the multiplicities, keeping its storage layout
+     @param plan Plan holding the block boundaries
+     @param state Engine of the call
+     @return Sum of the drawn pieces
      */
-    RandomPartition* createPartitionGroupsWithBernoulli(int size);
+    template <typename Policy>
+    SizeType poissonMultiplicities(Partition& a, const Plan& plan, SamplerState& state) const;
+    /**
+     Exact table algorithm for partition generation, the recursive method of Nijenhuis and Wilf.
+     Starting from m = goal_size, picks a pair (d,j) with probability d*p(m-jd)/(m*p(m)), adds j pieces of size d and continues with m-jd, which produces every partition with equal probability and never rejects.
+     Sizes up to 326 use the compile time count table and 64 bit arithmetic, larger ones the shared arbitrary precision PartitionCountTable.
+     Only supports the none restriction and sizes below 2^31, makePlan() picks divConquerDeterministic() or selfSimilarDivConquer() otherwise.
+     @param output Partition to fill, holds the result on return
+     @param plan Plan of the size, holding the divisor sums and counts
+     @param state Engine of the call
+     @see PartitionCountTable
+     */
+    void exactTableSample(Partition& output, const Plan& plan, SamplerState& state) const;
 
-    /**Geometric random variable. */
-    double U;
+    /**Engine, attempt count and statistics of the calls that take no SamplerState, and the source of the worker seeds.
+      @see seed()
+      @see attemptCount()
+      @see stats()*/
+    SamplerState own_state;
     /**Currently active restriction on generateRandomPartition(), default None.
       @see generateRandomPartition()*/
     activeRestrictions current_restriction;
+    /**Largest allowed piece size, 0 for none.
+      @see setRestriction()*/
+    SizeType largest_allowed_part;
+    /**Storage layout of generated partitions, default dense.
+      @see setStorage()*/
+    PartitionStorage::storageTypes current_storage;
+    /**Whether createPartitionGroups() jumps between nonzero multiplicities, default false.
+      @see setSkipSampling()*/
+    bool skip_sampling;
+    /**Plan of the last generateRandomPartition() or generateOddDistinct() call by size.
+      @see cachedPlan()*/
+    Plan last_plan;
+#ifdef PARTITION_CREATOR_STATS
+    /**
+     Adds one attempt to the statistics of a state.
+     @param state State of the call
+     @param attempt Partition the attempt was built in
+     @param storage_before Bytes of storage the partition held before the attempt
+     @param start Time the attempt started
+     @param generated Time the multiplicities were drawn and the acceptance check started
+     @param accepted Whether the attempt was accepted
+     */
+    void recordAttempt(SamplerState& state, const Partition& attempt, size_t storage_before, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point generated, bool accepted) const;
+#endif
 };
 
+/** Creator of RandomPartition, for sizes below 2^31. */
+typedef BasicPartitionCreator<int> PartitionCreator;
+/** Creator of RandomPartition64, for sizes of 2^31 and more. */
+typedef BasicPartitionCreator<long long> PartitionCreator64;
+
 #endif /* PartitionCreator_h */
@@ -0,0 +1,163 @@
+//
+//  PartitionShape.cpp
+//  ProbabilisticRejection
+//
+//  Young diagram views of a partition, computed on its (piece size, multiplicity) runs without listing every part.
+//
+
+#include "PartitionShape.h"
+#include <algorithm>
+
+//calls visit(part, multiplicity) for every nonzero multiplicity, in decreasing part order, until visit returns false
+template <typename SizeType, typename Visitor>
+static void forEachRunDescending(const BasicRandomPartition<SizeType>& partition, Visitor visit) {
+    if (partition.storage == PartitionStorage::dense)
+    {
+        for (size_t i = partition.partition_sizes.size(); i-- > 1; )
+        {
+            if (partition.partition_sizes[i] != 0 && !visit((SizeType)i, partition.partition_sizes[i]))
+                return;
+        }
+    }
+    else
+    {
+        for (size_t j = partition.sparse_parts.size(); j-- > 0; )
+        {
+            if (!visit(partition.sparse_parts[j].first, partition.sparse_parts[j].second))
+                return;
+        }
+    }
+}
+
+
+template <typename SizeType>
+void conjugatePartition(const BasicRandomPartition<SizeType>& partition, BasicRandomPartition<SizeType>& output) {
+    if (&partition == &output)
+    {
+        BasicRandomPartition<SizeType> copy(partition);
+        conjugatePartition(copy, output);
+        return;
+    }
+    output.reset(partition.totalSize());
+    //a conjugate has as many distinct piece sizes as the partition
+    if (partition.storage == PartitionStorage::sparse && output.storage == PartitionStorage::sparse)
+        output.sparse_parts.reserve(partition.sparse_parts.size());
+
+    //runs are read from the largest part down, where the column lengths grow, so the conjugate is set in increasing
+    //part order. A run's column length is only set once the next smaller piece size, which ends its columns, is known.
+    SizeType rows = 0;
+    SizeType pending_part = 0;
+    forEachRunDescending(partition, [&](SizeType part, SizeType multiplicity) {
+        if (rows > 0)
+            output.setMultiplicity(rows, pending_part - part);
+        rows += multiplicity;
+        pending_part = part;
+        return true;
+    });
+    if (rows > 0)
+        output.setMultiplicity(rows, pending_part);
+}
+
+
+template <typename SizeType>
+SizeType durfeeSquare(const BasicRandomPartition<SizeType>& partition) {
+    SizeType side = 0;
+    SizeType rows = 0;
+    forEachRunDescending(partition, [&](SizeType part, SizeType multiplicity) {
+        //the run covers rows rows + 1 to rows + multiplicity, all of length part, and row k is in the square while k <= part
+        if (part <= rows)
+            return false;
+        rows += multiplicity;
+        side = std::min(rows, part);
+        return part > rows;
+    });
+    return side;
+}
+
+
+template <typename SizeType>
+void diagramRows(const BasicRandomPartition<SizeType>& partition, std::vector<std::pair<SizeType,SizeType> >& rows) {
+    rows.clear();
+    if (partition.storage == PartitionStorage::sparse)
+        rows.reserve(partition.sparse_parts.size());
+    forEachRunDescending(partition, [&](SizeType part, SizeType multiplicity) {
+        rows.push_back(std::make_pair(part, multiplicity));
+        return true;
+    });
+}
+
+
+template <typename SizeType>
+BasicSortedParts<SizeType>::PartIterator::PartIterator(const Partition* partition, size_t position) : partition(partition), position(position), remaining(0), part(0) {
+    findRun();
+}
+
+
+template <typename SizeType>
+void BasicSortedParts<SizeType>::PartIterator::findRun() {
+    if (partition->storage == PartitionStorage::dense)
+    {
+        const std::vector<SizeType>& multiplicities = partition->partition_sizes;
+        while (position < multiplicities.size() && multiplicities[position] == 0)
+            ++position;
+        if (position < multiplicities.size())
+        {
+            part = (SizeType)position;
+            remaining = multiplicities[position];
+        }
+    }
+    else if (position < partition->sparse_parts.size())
+    {
+        part = partition->sparse_parts[position].first;
+        remaining = partition->sparse_parts[position].second;
+    }
+}
+
+
+template <typename SizeType>
+typename BasicSortedParts<SizeType>::PartIterator& BasicSortedParts<SizeType>::PartIterator::operator++() {
+    if (--remaining == 0)
+    {
+        ++position;
+        findRun();
+    }
+    return *this;
+}
+
+
+template <typename SizeType>
+typename BasicSortedParts<SizeType>::PartIterator BasicSortedParts<SizeType>::begin() const {
+    //index 0 of dense storage is not a piece size
+    if (partition->storage == PartitionStorage::dense)
+        return PartIterator(partition, std::min<size_t>(1, partition->partition_sizes.size()));
+    return PartIterator(partition, 0);
+}
+
+
+template <typename SizeType>
+typename BasicSortedParts<SizeType>::PartIterator BasicSortedParts<SizeType>::end() const {
+    if (partition->storage == PartitionStorage::dense)
+        return PartIterator(partition, partition->partition_sizes.size());
+    return PartIterator(partition, partition->sparse_parts.size());
+}
+
+
+template <typename SizeType>
+unsigned long long BasicSortedParts<SizeType>::count() const {
+    unsigned long long parts = 0;
+    forEachRunDescending(*partition, [&](SizeType, SizeType multiplicity) {
+        parts += multiplicity;
+        return true;
+    });
+    return parts;
+}
+
+
+template void conjugatePartition<int>(const RandomPartition& partition, RandomPartition& output);
+template void conjugatePartition<long long>(const RandomPartition64& partition, RandomPartition64& output);
+template int durfeeSquare<int>(const RandomPartition& partition);
+template long long durfeeSquare<long long>(const RandomPartition64& partition);
+template void diagramRows<int>(const RandomPartition& partition, std::vector<std::pair<int,int> >& rows);
+template void diagramRows<long long>(const RandomPartition64& partition, std::vector<std::pair<long long,long long> >& rows);
+template class BasicSortedParts<int>;
+template class BasicSortedParts<long long>;
@@ -0,0 +1,113 @@
+//
+//  PartitionShape.h
+//  ProbabilisticRejection
+//
+//  Young diagram views of a partition, computed on its (piece size, multiplicity) runs without listing every part.
+//
+
+#ifndef PartitionShape_h
+#define PartitionShape_h
+
+#include "PartitionCreator.h"
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/*
+ A partition with r distinct piece sizes is r runs of equal parts, while it may have far more parts than that: about
+ sqrt(n) distinct sizes against about sqrt(n)*log(n) parts for a typical partition of n. Every function here works on
+ the runs, so with sparse storage its cost is O(r) time and memory whatever the number of parts. Dense storage holds
+ one multiplicity per piece size up to n, so reading it costs O(n) however it is done.
+ */
+
+/**
+ Computes the conjugate partition, whose parts are the column lengths of the Young diagram: the conjugate has
+ multiplicity p_i - p_(i-1) of the piece size m_i + ... + m_r, for the piece sizes p_1 < ... < p_r of the partition
+ and their multiplicities m_i. Rows and columns swap, so the largest part and the number of parts swap too.
+ @param partition Partition to conjugate.
+ @param output Receives the conjugate, keeping its own storage layout. May be partition itself.
+ */
+template <typename SizeType>
+void conjugatePartition(const BasicRandomPartition<SizeType>& partition, BasicRandomPartition<SizeType>& output);
+
+/**
+ Returns the side of the Durfee square, the largest square that fits in the top left corner of the Young diagram:
+ the largest d such that at least d parts are d or larger. Conjugate partitions share it.
+ Stops at the run that crosses the diagonal, so only runs of parts larger than the square are read.
+ */
+template <typename SizeType>
+SizeType durfeeSquare(const BasicRandomPartition<SizeType>& partition);
+
+/**
+ Lists the rows of the Young diagram from the top, one rectangle of equal rows per run: the row length, which is a
+ piece size, and the number of rows of that length, which is its multiplicity. Lengths decrease down the list.
+ @param partition Partition to draw.
+ @param rows Receives the (row length, row count) pairs, replacing its contents.
+ */
+template <typename SizeType>
+void diagramRows(const BasicRandomPartition<SizeType>& partition, std::vector<std::pair<SizeType,SizeType> >& rows);
+
+/**
+ Every part of a partition in increasing order, each as often as its multiplicity, without building the list.
+ The partition must stay unchanged while it is iterated. Iterating a partition with sparse storage costs one step per
+ part and O(1) memory.
+ */
+template <typename SizeType>
+class BasicSortedParts {
+public:
+    /** Partition type iterated. */
+    typedef BasicRandomPartition<SizeType> Partition;
+
+    /** Forward iterator over the parts. */
+    class PartIterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef SizeType value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const SizeType* pointer;
+        typedef const SizeType& reference;
+
+        /** Current part. */
+        const SizeType& operator*() const { return part; }
+        /** Moves to the next part. */
+        PartIterator& operator++();
+        PartIterator operator++(int) { PartIterator previous = *this; ++*this; return previous; }
+        bool operator==(const PartIterator& other) const { return position == other.position && remaining == other.remaining; }
+        bool operator!=(const PartIterator& other) const { return !(*this == other); }
+
+    private:
+        friend class BasicSortedParts;
+        PartIterator(const Partition* partition, size_t position);
+        /** Moves to the first nonzero multiplicity at or after position. */
+        void findRun();
+
+        const Partition* partition;
+        /** Index of the current run in partition_sizes or sparse_parts. */
+        size_t position;
+        /** Copies of the current part still to visit, including this one. */
+        SizeType remaining;
+        SizeType part;
+    };
+
+    /** Constructor.
+     @param partition Partition to iterate, in any storage layout.*/
+    BasicSortedParts(const Partition& partition) : partition(&partition) {}
+
+    /** Smallest part. */
+    PartIterator begin() const;
+    /** Past the largest part. */
+    PartIterator end() const;
+    /** Number of parts, counted from the runs. */
+    unsigned long long count() const;
+
+private:
+    const Partition* partition;
+};
+
+/** Parts of a RandomPartition. */
+typedef BasicSortedParts<int> SortedParts;
+/** Parts of a RandomPartition64. */
+typedef BasicSortedParts<long long> SortedParts64;
+
+#endif /* PartitionShape_h */
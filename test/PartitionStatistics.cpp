@@ -0,0 +1,189 @@
+//
+//  PartitionStatistics.cpp
+//  ProbabilisticRejection
+//
+//  Running aggregates over a stream of partitions, for jobs that need statistics of many samples but not the samples.
+//
+
+#include "PartitionStatistics.h"
+#include <algorithm>
+
+//sample variance from a sum and a sum of squares over count values
+static double sampleVariance(double sum, double square_sum, unsigned long long count) {
+    if (count < 2)
+        return 0.0;
+    return std::max(0.0, (square_sum - sum*sum/count)/(count - 1));
+}
+
+
+template <typename SizeType>
+BasicPartitionStatistics<SizeType>::BasicPartitionStatistics(SizeType tracked_parts) {
+    this->tracked_parts = tracked_parts > 0 ? tracked_parts : 0;
+    clear();
+}
+
+
+template <typename SizeType>
+void BasicPartitionStatistics<SizeType>::clear() {
+    samples = 0;
+    part_sum = 0.0;
+    part_square_sum = 0.0;
+    largest_part_sum = 0.0;
+    untracked_part_sum = 0.0;
+    largest_part_counts.clear();
+    multiplicity_sums.clear();
+    multiplicity_square_sums.clear();
+}
+
+
+template <typename SizeType>
+inline void BasicPartitionStatistics<SizeType>::addMultiplicity(SizeType part, SizeType multiplicity) {
+    if (tracked_parts != 0 && part > tracked_parts)
+    {
+        untracked_part_sum += multiplicity;
+        return;
+    }
+    if ((size_t)part >= multiplicity_sums.size())
+    {
+        multiplicity_sums.resize(part + 1, 0.0);
+        multiplicity_square_sums.resize(part + 1, 0.0);
+    }
+    double m = multiplicity;
+    multiplicity_sums[part] += m;
+    multiplicity_square_sums[part] += m*m;
+}
+
+
+template <typename SizeType>
+void BasicPartitionStatistics<SizeType>::add(const Partition& partition) {
+    double parts = 0.0;
+    SizeType largest = 0;
+    if (partition.storage == PartitionStorage::dense)
+    {
+        for (size_t i = 1; i < partition.partition_sizes.size(); ++i)
+        {
+            SizeType multiplicity = partition.partition_sizes[i];
+            if (multiplicity != 0)
+            {
+                addMultiplicity((SizeType)i, multiplicity);
+                parts += multiplicity;
+                largest = (SizeType)i;
+            }
+        }
+    }
+    else
+    {
+        for (size_t j = 0; j < partition.sparse_parts.size(); ++j)
+        {
+            addMultiplicity(partition.sparse_parts[j].first, partition.sparse_parts[j].second);
+            parts += partition.sparse_parts[j].second;
+        }
+        if (!partition.sparse_parts.empty())
+            largest = partition.sparse_parts.back().first;
+    }
+
+    ++samples;
+    part_sum += parts;
+    part_square_sum += parts*parts;
+    largest_part_sum += largest;
+    if ((size_t)largest >= largest_part_counts.size())
+        largest_part_counts.resize(largest + 1, 0);
+    ++largest_part_counts[largest];
+}
+
+
+template <typename SizeType>
+void BasicPartitionStatistics<SizeType>::merge(const BasicPartitionStatistics& other) {
+    samples += other.samples;
+    part_sum += other.part_sum;
+    part_square_sum += other.part_square_sum;
+    largest_part_sum += other.largest_part_sum;
+    untracked_part_sum += other.untracked_part_sum;
+
+    if (largest_part_counts.size() < other.largest_part_counts.size())
+        largest_part_counts.resize(other.largest_part_counts.size(), 0);
+    for (size_t m = 0; m < other.largest_part_counts.size(); ++m)
+        largest_part_counts[m] += other.largest_part_counts[m];
+
+    if (multiplicity_sums.size() < other.multiplicity_sums.size())
+    {
+        multiplicity_sums.resize(other.multiplicity_sums.size(), 0.0);
+        multiplicity_square_sums.resize(other.multiplicity_sums.size(), 0.0);
+    }
+    for (size_t i = 0; i < other.multiplicity_sums.size(); ++i)
+    {
+        multiplicity_sums[i] += other.multiplicity_sums[i];
+        multiplicity_square_sums[i] += other.multiplicity_square_sums[i];
+    }
+}
+
+
+template <typename SizeType>
+unsigned long long BasicPartitionStatistics<SizeType>::sampleCount() const {
+    return samples;
+}
+
+
+template <typename SizeType>
+double BasicPartitionStatistics<SizeType>::meanParts() const {
+    return samples > 0 ? part_sum/samples : 0.0;
+}
+
+
+template <typename SizeType>
+double BasicPartitionStatistics<SizeType>::partsVariance() const {
+    return sampleVariance(part_sum, part_square_sum, samples);
+}
+
+
+template <typename SizeType>
+const std::vector<unsigned long long>& BasicPartitionStatistics<SizeType>::largestPartCounts() const {
+    return largest_part_counts;
+}
+
+
+template <typename SizeType>
+double BasicPartitionStatistics<SizeType>::meanLargestPart() const {
+    return samples > 0 ? largest_part_sum/samples : 0.0;
+}
+
+
+template <typename SizeType>
+double BasicPartitionStatistics<SizeType>::multiplicityMean(SizeType part) const {
+    if (samples == 0 || part <= 0 || (size_t)part >= multiplicity_sums.size())
+        return 0.0;
+    return multiplicity_sums[part]/samples;
+}
+
+
+template <typename SizeType>
+double BasicPartitionStatistics<SizeType>::multiplicityVariance(SizeType part) const {
+    if (part <= 0 || (size_t)part >= multiplicity_sums.size())
+        return 0.0;
+    return sampleVariance(multiplicity_sums[part], multiplicity_square_sums[part], samples);
+}
+
+
+template <typename SizeType>
+std::vector<double> BasicPartitionStatistics<SizeType>::profile() const {
+    //every part above the largest tracked piece size seen is untracked, so they make up the last column
+    size_t columns = std::max<size_t>(multiplicity_sums.size(), 1);
+    std::vector<double> mean_profile(columns + 1, 0.0);
+    if (samples == 0)
+        return mean_profile;
+    mean_profile[columns] = untracked_part_sum/samples;
+    for (size_t k = columns - 1; k >= 1; --k)
+        mean_profile[k] = mean_profile[k + 1] + multiplicity_sums[k]/samples;
+    mean_profile[0] = meanParts();
+    return mean_profile;
+}
+
+
+template <typename SizeType>
+SizeType BasicPartitionStatistics<SizeType>::trackedParts() const {
+    return tracked_parts;
+}
+
+
+template class BasicPartitionStatistics<int>;
+template class BasicPartitionStatistics<long long>;
@@ -0,0 +1,89 @@
+//
+//  PartitionStatistics.h
+//  ProbabilisticRejection
+//
+//  Running aggregates over a stream of partitions, for jobs that need statistics of many samples but not the samples.
+//
+
+#ifndef PartitionStatistics_h
+#define PartitionStatistics_h
+
+#include "PartitionCreator.h"
+#include <vector>
+
+/**
+ Aggregates over any number of partitions, updated one partition at a time: the number of parts, the law of the largest part, the mean and variance of every multiplicity, and the mean profile of the Young diagram, whose scaled form tends to the limit shape.
+
+ Memory depends on the largest piece size seen, never on the number of partitions added, so statistics of millions of samples can be gathered without keeping any of them. Pass partitions to add() straight from a sampler, a sweep visitor or a corpus, or let BasicPartitionCreator::generateStatistics() sample and reduce on every thread.
+
+ Statistics are combined with merge(). Each thread fills its own object and the objects are merged once the threads are done, so adding never takes a lock. Merging is exact for every count, and the sums of multiplicities are kept in double precision.
+
+ Multiplicity moments are tracked for piece sizes up to a bound set on construction. Parts above the bound still count in the number of parts, the largest part and the profile, which stays exact up to the bound.
+ */
+template <typename SizeType>
+class BasicPartitionStatistics {
+public:
+    /** Partition type accepted. */
+    typedef BasicRandomPartition<SizeType> Partition;
+
+    /** Constructor. Creates empty statistics.
+     @param tracked_parts Largest piece size whose multiplicity moments are tracked, 0 for every piece size seen.*/
+    BasicPartitionStatistics(SizeType tracked_parts = 0);
+
+    /** Adds one partition. Any storage layout is accepted. */
+    void add(const Partition& partition);
+    /** Adds every partition added to other, as if they had been added here. Both must track the same piece sizes. */
+    void merge(const BasicPartitionStatistics& other);
+    /** Removes every partition added so far, keeping the tracking bound. */
+    void clear();
+
+    /** Number of partitions added. */
+    unsigned long long sampleCount() const;
+    /** Mean number of parts. */
+    double meanParts() const;
+    /** Sample variance of the number of parts. */
+    double partsVariance() const;
+    /** Number of partitions added by largest part. Index m holds the partitions whose largest part is m, the empty partition counts at 0. The vector reaches the largest part seen. */
+    const std::vector<unsigned long long>& largestPartCounts() const;
+    /** Mean largest part. */
+    double meanLargestPart() const;
+    /** Mean multiplicity of a piece size, 0 above the largest piece size seen.
+     @param part Piece size, at most trackedParts() unless that is 0.*/
+    double multiplicityMean(SizeType part) const;
+    /** Sample variance of the multiplicity of a piece size.
+     @param part Piece size, at most trackedParts() unless that is 0.*/
+    double multiplicityVariance(SizeType part) const;
+    /**
+     Mean profile of the Young diagram. Entry k is the mean number of parts of size k or more, which is the mean length of column k. Entry 0 is the mean number of parts.
+     For partitions of n, the points (k/sqrt(n), profile[k]/sqrt(n)) tend to the limit shape of the class, e^(-c*u) + e^(-c*v) = 1 with c = pi/sqrt(6) for unrestricted partitions.
+     @return Mean profile, one entry past the largest tracked piece size seen.*/
+    std::vector<double> profile() const;
+    /** Largest piece size whose multiplicity moments are tracked, 0 for every one. */
+    SizeType trackedParts() const;
+
+private:
+    /** Adds one nonzero multiplicity of the partition being added. */
+    void addMultiplicity(SizeType part, SizeType multiplicity);
+
+    /** Bound on tracked piece sizes, 0 for none. */
+    SizeType tracked_parts;
+    /** Partitions added. */
+    unsigned long long samples;
+    /** Sum of the numbers of parts, and of their squares. */
+    double part_sum, part_square_sum;
+    /** Sum of the largest parts. */
+    double largest_part_sum;
+    /** Partitions by largest part. */
+    std::vector<unsigned long long> largest_part_counts;
+    /** Sum of the multiplicities of every tracked piece size, and of their squares. Index 0 is unused. */
+    std::vector<double> multiplicity_sums, multiplicity_square_sums;
+    /** Sum of the numbers of parts above the tracking bound. */
+    double untracked_part_sum;
+};
+
+/** Statistics of RandomPartition. */
+typedef BasicPartitionStatistics<int> PartitionStatistics;
+/** Statistics of RandomPartition64. */
+typedef BasicPartitionStatistics<long long> PartitionStatistics64;
+
+#endif /* PartitionStatistics_h */
@@ -0,0 +1,141 @@
+//
+//  PartitionWriter.cpp
+//  ProbabilisticRejection
+//
+//  Buffered writer for partition corpora, formatting and writing on a background thread.
+//
+
+#include "PartitionWriter.h"
+#include <utility>
+
+template <typename SizeType>
+BasicPartitionWriter<SizeType>::BasicPartitionWriter(std::string filename, size_t buffer_bytes) {
+    file.open((filename + ".txt").c_str(), std::ios::app | std::ios::binary);
+    buffer_limit = buffer_bytes;
+    flushes_requested = 0;
+    flushes_completed = 0;
+    stopping = false;
+    worker = std::thread(&BasicPartitionWriter::run, this);
+}
+
+
+template <typename SizeType>
+BasicPartitionWriter<SizeType>::~BasicPartitionWriter() {
+    close();
+}
+
+
+template <typename SizeType>
+bool BasicPartitionWriter<SizeType>::isOpen() const {
+    return file.is_open();
+}
+
+
+template <typename SizeType>
+void BasicPartitionWriter<SizeType>::write(const Partition& partition) {
+    std::lock_guard<std::mutex> guard(queue_lock);
+    if (stopping)
+        return;
+    pending.push_back(partition);
+    queue_changed.notify_one();
+}
+
+
+template <typename SizeType>
+void BasicPartitionWriter<SizeType>::write(Partition&& partition) {
+    std::lock_guard<std::mutex> guard(queue_lock);
+    if (stopping)
+        return;
+    pending.push_back(std::move(partition));
+    queue_changed.notify_one();
+}
+
+
+template <typename SizeType>
+void BasicPartitionWriter<SizeType>::write(Partition* partition) {
+    if (partition == nullptr)
+        return;
+    write(std::move(*partition));
+    delete partition;
+}
+
+
+template <typename SizeType>
+void BasicPartitionWriter<SizeType>::flush() {
+    std::unique_lock<std::mutex> lock(queue_lock);
+    if (stopping)
+        return;
+    unsigned long long ticket = ++flushes_requested;
+    queue_changed.notify_one();
+    flush_done.wait(lock, [&]() { return flushes_completed >= ticket; });
+}
+
+
+template <typename SizeType>
+void BasicPartitionWriter<SizeType>::close() {
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        stopping = true;
+        queue_changed.notify_one();
+    }
+    if (worker.joinable())
+        worker.join();
+    if (file.is_open())
+        file.close();
+}
+
+
+template <typename SizeType>
+void BasicPartitionWriter<SizeType>::run() {
+    std::string buffer;
+    buffer.reserve(buffer_limit + (1 << 16));
+    //partitions are swapped out of the queue in batches, so writers only hold the lock for a push_back
+    std::vector<Partition> batch;
+
+    std::unique_lock<std::mutex> lock(queue_lock);
+    for (;;)
+    {
+        queue_changed.wait(lock, [&]() { return !pending.empty() || stopping || flushes_requested > flushes_completed; });
+        batch.swap(pending);
+        unsigned long long flush_target = flushes_requested;
+        bool finish = stopping && batch.empty();
+        lock.unlock();
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            formatPartition(buffer, batch[i]);
+            if (buffer.size() >= buffer_limit)
+            {
+                if (file.is_open())
+                    file.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+        batch.clear();
+
+        //a flush or close writes out the partly filled buffer as well
+        bool flushing = flush_target > flushes_completed || finish;
+        if (flushing)
+        {
+            if (file.is_open())
+            {
+                file.write(buffer.data(), buffer.size());
+                file.flush();
+            }
+            buffer.clear();
+        }
+
+        lock.lock();
+        if (flushing)
+        {
+            flushes_completed = flush_target;
+            flush_done.notify_all();
+        }
+        if (finish)
+            return;
+    }
+}
+
+
+template class BasicPartitionWriter<int>;
+template class BasicPartitionWriter<long long>;
@@ -0,0 +1,92 @@
+//
+//  PartitionWriter.h
+//  ProbabilisticRejection
+//
+//  Buffered writer for partition corpora, formatting and writing on a background thread.
+//
+
+#ifndef PartitionWriter_h
+#define PartitionWriter_h
+
+#include "PartitionCreator.h"
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ Writes partitions to filename.txt in the format of appendToFile(), one line per partition, keeping the file open for its whole lifetime.
+
+ write() only queues the partition. A background thread owned by the writer turns queued partitions into text in a large buffer and writes the buffer out whenever it fills, so threads generating partitions never wait for formatting or for the disk. write() may be called from several threads at once, and lines appear in the order the calls were made.
+
+ The queue is not bounded: if partitions are produced much faster than the disk takes them, they wait in memory.
+
+ Lines are guaranteed to be in the file only after flush() or close() returns, or the writer is destroyed.
+ */
+template <typename SizeType>
+class BasicPartitionWriter {
+public:
+    /** Partition type accepted by this writer. */
+    typedef BasicRandomPartition<SizeType> Partition;
+
+    /** Constructor. Opens filename.txt for appending, like appendToFile(), and starts the background thread.
+     @param filename File name without the .txt extension.
+     @param buffer_bytes Size the text buffer grows to before it is written to the file.*/
+    BasicPartitionWriter(std::string filename, size_t buffer_bytes = 1 << 22);
+    /** Destructor. Writes every queued partition, then closes the file. */
+    ~BasicPartitionWriter();
+
+    /** Returns whether the file could be opened. Partitions written to a writer whose file is not open are dropped. */
+    bool isOpen() const;
+
+    /** Queues a copy of a partition for writing. */
+    void write(const Partition& partition);
+    /** Queues a partition for writing, taking over its storage. */
+    void write(Partition&& partition);
+    /** Queues a partition for writing and deletes it, for partitions from the pointer returning samplers. Does nothing for nullptr. */
+    void write(Partition* partition);
+
+    /** Blocks until every partition queued so far is in the file. */
+    void flush();
+    /** Writes every queued partition, stops the background thread and closes the file. Further writes are dropped. */
+    void close();
+
+private:
+    BasicPartitionWriter(const BasicPartitionWriter&) = delete;
+    BasicPartitionWriter& operator=(const BasicPartitionWriter&) = delete;
+
+    /** Background thread body: formats queued partitions and writes full buffers until closed. */
+    void run();
+
+    /** Output file, used only by the background thread once it is started. */
+    std::ofstream file;
+    /** Buffer size that triggers a write to the file. */
+    size_t buffer_limit;
+
+    /** Guards the members below. */
+    std::mutex queue_lock;
+    /** Wakes the background thread when partitions are queued, a flush is requested, or the writer closes. */
+    std::condition_variable queue_changed;
+    /** Wakes flush() when the background thread finished a flush. */
+    std::condition_variable flush_done;
+    /** Partitions waiting to be formatted. */
+    std::vector<Partition> pending;
+    /** Number of flushes requested so far. */
+    unsigned long long flushes_requested;
+    /** Number of requested flushes that have completed. */
+    unsigned long long flushes_completed;
+    /** Set by close(), tells the background thread to finish. */
+    bool stopping;
+
+    /** Background thread formatting and writing the queue. */
+    std::thread worker;
+};
+
+/** Writer of RandomPartition. */
+typedef BasicPartitionWriter<int> PartitionWriter;
+/** Writer of RandomPartition64. */
+typedef BasicPartitionWriter<long long> PartitionWriter64;
+
+#endif /* PartitionWriter_h */
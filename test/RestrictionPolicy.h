@@ -0,0 +1,61 @@
+//
+//  RestrictionPolicy.h
+//  ProbabilisticRejection
+//
+//  Compile time descriptions of the partition classes PartitionCreator can sample.
+//
+
+#ifndef RestrictionPolicy_h
+#define RestrictionPolicy_h
+
+/*
+ A restriction policy is a type with three integer constants:
+
+ - first_part: smallest allowed piece size
+ - part_step: distance between allowed piece sizes, so the allowed sizes are first_part, first_part + part_step, ...
+ - max_multiplicity: largest number of pieces of one size, 0 for no limit. 1 gives partitions into distinct parts.
+
+ The samplers in PartitionCreator.cpp are templates on the policy, so every loop over piece sizes is compiled for one
+ class with its step and multiplicity law fixed. An upper bound on piece sizes applies to every policy and is given at
+ run time, see PartitionCreator::setRestriction().
+
+ Allowed piece sizes must either start at 1 with a step of 1 or 2, or be the multiples of part_step. Every shipped
+ policy does, and it keeps the check for sizes that have no partition in the class simple.
+ */
+
+/** Pieces of every size. */
+struct AllParts {
+    static const int first_part = 1;
+    static const int part_step = 1;
+    static const int max_multiplicity = 0;
+};
+
+/** Pieces of odd size only. */
+struct OddParts {
+    static const int first_part = 1;
+    static const int part_step = 2;
+    static const int max_multiplicity = 0;
+};
+
+/** Pieces of even size only. */
+struct EvenParts {
+    static const int first_part = 2;
+    static const int part_step = 2;
+    static const int max_multiplicity = 0;
+};
+
+/** Pieces of every size, no two of the same size. */
+struct DistinctParts {
+    static const int first_part = 1;
+    static const int part_step = 1;
+    static const int max_multiplicity = 1;
+};
+
+/** Pieces of odd size, no two of the same size. */
+struct OddDistinctParts {
+    static const int first_part = 1;
+    static const int part_step = 2;
+    static const int max_multiplicity = 1;
+};
+
+#endif /* RestrictionPolicy_h */
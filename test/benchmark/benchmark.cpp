@@ -0,0 +1,731 @@
+//
+//  benchmark.cpp
+//  ProbabilisticRejection
+//
+//  Microbenchmark for the geometric multiplicity kernel used by PartitionCreator::createPartitionGroups().
+//
+//  Reports indices per second for the original per-index loop (one uniform, one log, one floor per index)
+//  and for the block kernel, both with random number generation included and for the kernel alone.
+//
+//  Also reports partitions written per second by appendToFile() and by PartitionWriter, the cost of one partition
+//  of every size from 1 to N through generateSweep() against one generateRandomPartition() call per size, and the
+//  cost of aggregate statistics through generateStatistics() against a generateBatch() reduced afterwards. The shape
+//  section times the run-length Young diagram kernels of PartitionShape.h against expanding the partition into its
+//  list of parts, on self similar samples up to 10^10. The tuning section reports attempts per sample of the
+//  samplers at sizes up to 10^4, both with the leading order Boltzmann parameter they used to draw with and with the
+//  solved one, on the same plan and seed.
+//
+//  The sampler suite runs every sampler over a grid of sizes from 20 to 10^8 and reports samples per second,
+//  attempts per accepted sample, nanoseconds per attempt and peak resident memory, optionally as JSON and
+//  compared against a stored baseline such as benchmark/baseline.json. Against a baseline it also reports the ratio of
+//  baseline attempts to current attempts per sample, which shows changes in acceptance rate apart from speed. The two
+//  distinct odd rows set divide and conquer over a growing block of small piece sizes, whose attempts per sample stay
+//  flat in n, against the Poisson process, which only leaves out the piece of size 1.
+//
+//  Every sampler cell starts by loading the exact partition counts from a cache file, partition_counts.pcnt in the working
+//  directory unless --count-cache names another or "" for none, and saves them there when it grows the table. So only
+//  the first run of exact_table at a size pays for the counts, and later cells and runs start at once.
+//
+//  usage: benchmark [--kernel] [--writer] [--sweep] [--reduce] [--shape] [--tuning] [--samplers] [--quick] [--json file] [--baseline file] [--tolerance fraction] [--count-cache file]
+//
+//  Without a section flag every section runs. --quick stops the grid at 10^4 with shorter runs, the sweep at 2000,
+//  the reduce section at 2000 samples, the tuning section at 200 samples and the shape section at 10^8. With
+//  --baseline, the exit status is 1 if any sampler and size got slower than the baseline by more than the tolerance
+//  (default 0.25), judged only where at least 10 samples were drawn both in this run and in the baseline, as fewer
+//  vary too much. A baseline measured with another multiplicity kernel than this host uses is not compared at all.
+//
+
+#include "PartitionCreator.h"
+#include "PartitionCountTable.h"
+#include "MultiplicityKernel.h"
+#include "PartitionShape.h"
+#include "PartitionStatistics.h"
+#include "PartitionWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//run fn until at least min_seconds have passed and return indices per second
+template <typename Function>
+double indicesPerSecond(Function fn, long long indices_per_call, double min_seconds = 0.5) {
+    long long calls = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do
+    {
+        fn();
+        ++calls;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    return calls*indices_per_call/elapsed;
+}
+
+void kernelBenchmark() {
+    const int size = 1000000;
+    const int block_size = 256;
+    double c = 3.14159/sqrt(6);
+    double log_y = log(1 - (c / (sqrt(size))));
+
+    RandomEngine generator(12345);
+    std::uniform_real_distribution<double> uni_distribution(0.0,1.0);
+    std::vector<int> multiplicities(size+1);
+    long long checksum = 0;
+
+    //the loop createPartitionGroups used before the block kernel
+    double per_index = indicesPerSecond([&]() {
+        for (int i = 1; i <= size; ++i)
+            multiplicities[i] = floor(log(uni_distribution(generator))/(log_y*i));
+        checksum += multiplicities[1];
+    }, size);
+
+    //block uniforms followed by one kernel call per block, as createPartitionGroups does now
+    double uniforms[block_size];
+    double block = indicesPerSecond([&]() {
+        for (int i = 1; i <= size; i += block_size)
+        {
+            int count = std::min(block_size, size - i + 1);
+            for (int t = 0; t < count; ++t)
+                uniforms[t] = 1.0 - uni_distribution(generator);
+            geometricMultiplicities(uniforms, count, i, 1, log_y, &multiplicities[i]);
+        }
+        checksum += multiplicities[1];
+    }, size);
+
+    //kernel alone on pregenerated uniforms, to separate the log and division cost from the generator
+    std::vector<double> pregenerated(size);
+    for (int i = 0; i < size; ++i)
+        pregenerated[i] = 1.0 - uni_distribution(generator);
+    double kernel_scalar = indicesPerSecond([&]() {
+        geometricMultiplicitiesScalar(&pregenerated[0], size, 1, 1, log_y, &multiplicities[1]);
+        checksum += multiplicities[1];
+    }, size);
+    double kernel_dispatched = indicesPerSecond([&]() {
+        geometricMultiplicities(&pregenerated[0], size, 1, 1, log_y, &multiplicities[1]);
+        checksum += multiplicities[1];
+    }, size);
+
+    //the dispatched kernel must agree with the scalar one index for index
+    std::vector<int> reference(size);
+    geometricMultiplicitiesScalar(&pregenerated[0], size, 1, 1, log_y, &reference[0]);
+    geometricMultiplicities(&pregenerated[0], size, 1, 1, log_y, &multiplicities[1]);
+    int mismatches = 0;
+    for (int i = 0; i < size; ++i)
+        mismatches += reference[i] != multiplicities[i+1];
+
+    std::cout << "geometric multiplicity kernel, n = " << size << ", dispatched variant: " << geometricKernelName() << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  per-index loop (uniform + log)   " << std::setw(8) << per_index/1e6 << " M indices/s" << std::endl;
+    std::cout << "  block uniforms + kernel          " << std::setw(8) << block/1e6 << " M indices/s  (x" << std::setprecision(2) << block/per_index << ")" << std::setprecision(1) << std::endl;
+    std::cout << "  kernel only, scalar              " << std::setw(8) << kernel_scalar/1e6 << " M indices/s" << std::endl;
+    std::cout << "  kernel only, " << std::left << std::setw(20) << geometricKernelName() << std::right << std::setw(8) << kernel_dispatched/1e6 << " M indices/s  (x" << std::setprecision(2) << kernel_dispatched/kernel_scalar << ")" << std::endl;
+    std::cout << "  mismatches against scalar kernel: " << mismatches << "   (checksum " << checksum << ")" << std::endl;
+}
+
+void writerBenchmark() {
+    const int size = 10000;
+    const int count = 1000;
+    const std::string filename = "benchmark_writer_output";
+
+    PartitionCreator creator;
+    creator.seed(12345);
+    std::vector<RandomPartition*> partitions = creator.generateBatch(size, count);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        appendToFile(filename, partitions[i]);
+    double append_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove((filename + ".txt").c_str());
+
+    //time until the writer takes the last partition, which is what a generating thread waits for, and until it is on disk
+    start = std::chrono::steady_clock::now();
+    double queue_seconds;
+    {
+        PartitionWriter writer(filename);
+        for (int i = 0; i < count; ++i)
+            writer.write(*partitions[i]);
+        queue_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    double writer_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove((filename + ".txt").c_str());
+
+    for (int i = 0; i < count; ++i)
+        delete partitions[i];
+
+    std::cout << "partition writer, " << count << " partitions of size " << size << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  appendToFile                     " << std::setw(8) << count/append_seconds << " partitions/s" << std::endl;
+    std::cout << "  PartitionWriter, until on disk   " << std::setw(8) << count/writer_seconds << " partitions/s  (x" << std::setprecision(2) << append_seconds/writer_seconds << ")" << std::setprecision(1) << std::endl;
+    std::cout << "  PartitionWriter, caller blocked  " << std::setw(8) << count/queue_seconds << " partitions/s" << std::endl;
+}
+
+//one configuration of the sweep comparison
+struct SweepConfig {
+    const char* name;
+    PartitionCreator::sampleAlgorithms algorithm;
+    PartitionCreator::activeRestrictions restriction;
+    RandomPartition::storageTypes storage;
+    bool skip_sampling;
+    //sizes are cut at this bound, 0 for none. Separate calls under a distinct parts restriction reject almost everything.
+    int size_bound;
+};
+
+static const SweepConfig sweep_configs[] = {
+    {"div_conquer_deterministic", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::dense, false, 0},
+    {"div_conquer_deterministic/skip", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::sparse, true, 0},
+    {"poisson_process", PartitionCreator::poisson_process, PartitionCreator::none, RandomPartition::sparse, false, 0},
+    {"odd_parts", PartitionCreator::div_conquer_deterministic, PartitionCreator::odd_parts, RandomPartition::sparse, true, 0},
+    {"distinct_parts", PartitionCreator::div_conquer_deterministic, PartitionCreator::distinct_parts, RandomPartition::sparse, true, 2000},
+};
+
+void sweepBenchmark(bool quick) {
+    const int sweep_size = quick ? 2000 : 10000;
+    
+    std::cout << "sweep of every size from 1 to " << sweep_size << std::endl;
+    std::cout << "  " << std::left << std::setw(32) << "sampler" << std::right << std::setw(8) << "sizes" << std::right << std::setw(14) << "per size s" << std::setw(12) << "attempts"
+        << std::setw(12) << "sweep s" << std::setw(12) << "attempts" << std::setw(10) << "speedup" << std::endl;
+    for (size_t c = 0; c < sizeof(sweep_configs)/sizeof(sweep_configs[0]); ++c)
+    {
+        const SweepConfig& config = sweep_configs[c];
+        const int largest = config.size_bound > 0 ? std::min(sweep_size, config.size_bound) : sweep_size;
+        PartitionCreator creator;
+        creator.seed(12345);
+        creator.setRestriction(config.restriction);
+        creator.setStorage(config.storage);
+        creator.setSkipSampling(config.skip_sampling);
+        
+        //the checksums keep the partitions from being optimized away
+        RandomPartition output(config.storage);
+        long long checksum = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int n = 1; n <= largest; ++n)
+        {
+            if (creator.generateRandomPartition(output, n, config.algorithm))
+                checksum += output.getMultiplicity(1);
+        }
+        double separate_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        unsigned long long separate_attempts = creator.attemptCount();
+        
+        start = std::chrono::steady_clock::now();
+        creator.generateSweep(1, largest, [&](int, const RandomPartition& partition) {
+            checksum -= partition.getMultiplicity(1);
+        }, config.algorithm);
+        double sweep_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        unsigned long long sweep_attempts = creator.attemptCount() - separate_attempts;
+        
+        std::cout << "  " << std::left << std::setw(32) << config.name << std::right << std::setw(8) << largest << std::fixed << std::setprecision(3)
+            << std::setw(14) << separate_seconds << std::setw(12) << separate_attempts << std::setw(12) << sweep_seconds << std::setw(12) << sweep_attempts
+            << std::setprecision(1) << std::setw(9) << separate_seconds/sweep_seconds << "x" << "   (checksum " << checksum << ")" << std::defaultfloat << std::endl;
+    }
+}
+
+void reduceBenchmark(bool quick) {
+    const int size = 10000;
+    const int count = quick ? 2000 : 20000;
+    
+    PartitionCreator creator;
+    creator.seed(12345);
+    creator.setStorage(RandomPartition::sparse);
+    creator.setSkipSampling(true);
+    
+    //every partition is kept until the batch is complete, then reduced
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<RandomPartition*> batch = creator.generateBatch(size, count);
+    PartitionStatistics batch_statistics;
+    size_t held_bytes = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        batch_statistics.add(*batch[i]);
+        held_bytes += sizeof(RandomPartition) + batch[i]->sparse_parts.capacity()*sizeof(batch[i]->sparse_parts[0]);
+        delete batch[i];
+    }
+    double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    start = std::chrono::steady_clock::now();
+    PartitionStatistics statistics;
+    creator.generateStatistics(statistics, size, count);
+    double stream_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "aggregate statistics, " << count << " sparse partitions of size " << size << ", every hardware thread" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  generateBatch, then reduced      " << std::setw(10) << count/batch_seconds << " partitions/s, " << held_bytes/1024 << " KiB of partitions held" << std::endl;
+    std::cout << "  generateStatistics               " << std::setw(10) << count/stream_seconds << " partitions/s  (x" << std::setprecision(2) << batch_seconds/stream_seconds << ")" << std::endl;
+    std::cout << std::setprecision(3) << "  mean parts " << batch_statistics.meanParts() << " and " << statistics.meanParts()
+        << ", mean largest part " << batch_statistics.meanLargestPart() << " and " << statistics.meanLargestPart() << std::defaultfloat << std::endl;
+}
+
+void shapeBenchmark(bool quick) {
+    const long long largest_size = quick ? 100000000LL : 10000000000LL;
+    
+    PartitionCreator64 creator;
+    creator.seed(12345);
+    creator.setStorage(RandomPartition64::sparse);
+    creator.setSkipSampling(true);
+    
+    std::cout << "Young diagram kernels on self similar samples, microseconds per call" << std::endl;
+    std::cout << "  " << std::right << std::setw(12) << "n" << std::setw(10) << "runs" << std::setw(12) << "parts" << std::setw(12) << "expand"
+        << std::setw(12) << "durfee" << std::setw(12) << "conjugate" << std::setw(12) << "rows" << std::setw(12) << "iterate" << std::endl;
+    long long mismatches = 0;
+    for (long long n = 1000000; n <= largest_size; n *= 100)
+    {
+        RandomPartition64 partition(RandomPartition64::sparse);
+        creator.generateRandomPartition(partition, n, PartitionCreator64::self_similar_div_conquer);
+        
+        //reference: every part in decreasing order, and the Durfee square read from that list
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<long long> parts;
+        for (size_t j = partition.sparse_parts.size(); j-- > 0; )
+            parts.insert(parts.end(), partition.sparse_parts[j].second, partition.sparse_parts[j].first);
+        long long listed_durfee = 0;
+        while (listed_durfee < (long long)parts.size() && parts[listed_durfee] > listed_durfee)
+            ++listed_durfee;
+        double expand_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        
+        start = std::chrono::steady_clock::now();
+        long long durfee = durfeeSquare(partition);
+        double durfee_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        
+        RandomPartition64 conjugate(RandomPartition64::sparse);
+        start = std::chrono::steady_clock::now();
+        conjugatePartition(partition, conjugate);
+        double conjugate_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        
+        std::vector<std::pair<long long,long long> > rows;
+        start = std::chrono::steady_clock::now();
+        diagramRows(partition, rows);
+        double rows_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        
+        //the sorted parts iterator visits every part, so it costs what the expansion does without its memory
+        start = std::chrono::steady_clock::now();
+        long long iterated_sum = 0;
+        SortedParts64 sorted(partition);
+        for (SortedParts64::PartIterator it = sorted.begin(); it != sorted.end(); ++it)
+            iterated_sum += *it;
+        double iterate_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        
+        //conjugation swaps the largest part and the number of parts and keeps the size and the Durfee square
+        mismatches += durfee != listed_durfee;
+        mismatches += durfeeSquare(conjugate) != durfee;
+        mismatches += conjugate.totalSize() != n || iterated_sum != n;
+        mismatches += conjugate.sparse_parts.back().first != (long long)parts.size() || (long long)sorted.count() != (long long)parts.size();
+        mismatches += rows.size() != partition.sparse_parts.size() || conjugate.sparse_parts.size() != partition.sparse_parts.size();
+        
+        std::cout << "  " << std::setw(12) << n << std::setw(10) << partition.sparse_parts.size() << std::setw(12) << parts.size() << std::fixed << std::setprecision(1)
+            << std::setw(12) << expand_us << std::setw(12) << durfee_us << std::setw(12) << conjugate_us << std::setw(12) << rows_us << std::setw(12) << iterate_us << std::defaultfloat << std::endl;
+    }
+    std::cout << "  mismatches against the list of parts: " << mismatches << std::endl;
+}
+
+//one sampler of the tuning section, run at sizes from 100 up to largest_n
+struct TuningConfig {
+    const char* name;
+    PartitionCreator::sampleAlgorithms algorithm;
+    PartitionCreator::activeRestrictions restriction;
+    //fraction of piece sizes allowed, times b/(b+1) for multiplicities capped at b
+    double share;
+    int largest_n;
+};
+
+static const TuningConfig tuning_configs[] = {
+    {"rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::none, 1.0, 1000},
+    {"div_conquer_deterministic", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, 1.0, 10000},
+    {"odd_parts/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::odd_parts, 0.5, 10000},
+    {"distinct_parts/rejection", PartitionCreator::rejection_sample, PartitionCreator::distinct_parts, 0.5, 1000},
+    {"distinct_parts/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::distinct_parts, 0.5, 10000},
+};
+
+//mean attempts per sample of count samples from plan with a fixed seed
+static double attemptsPerSample(const PartitionCreator& creator, const SamplerPlan& plan, int count) {
+    SamplerState state(12345);
+    RandomPartition output(RandomPartition::sparse);
+    for (int i = 0; i < count; ++i)
+        creator.generateRandomPartition(output, plan, state);
+    return (double)state.attempt_count/count;
+}
+
+void tuningBenchmark(bool quick) {
+    const int count = quick ? 200 : 1000;
+
+    //the Boltzmann parameter used to be the leading order x = 1 - c*sqrt(share/n), c = pi/sqrt(6), and is now solved so
+    //that the attempts have expected size n. Both run on the same plan and seed, so only x differs.
+    std::cout << "Boltzmann parameter, attempts per sample over " << count << " samples with the leading order x and the solved x" << std::endl;
+    std::cout << "  " << std::left << std::setw(32) << "sampler" << std::right << std::setw(8) << "n" << std::setw(16) << "leading order"
+        << std::setw(12) << "solved" << std::setw(10) << "gain" << std::endl;
+    for (size_t c = 0; c < sizeof(tuning_configs)/sizeof(tuning_configs[0]); ++c)
+    {
+        const TuningConfig& config = tuning_configs[c];
+        PartitionCreator creator;
+        creator.setStorage(RandomPartition::sparse);
+        creator.setSkipSampling(true);
+        for (int n = 100; n <= config.largest_n; n *= 10)
+        {
+            SamplerPlan solved = creator.makePlan(n, config.algorithm, config.restriction, 0);
+            SamplerPlan leading_order = solved;
+            double s = 3.14159265358979323846/sqrt(6.0)*sqrt(config.share/n);
+            leading_order.log_x = log(1 - s);
+
+            double before = attemptsPerSample(creator, leading_order, count);
+            double after = attemptsPerSample(creator, solved, count);
+            std::cout << "  " << std::left << std::setw(32) << config.name << std::right << std::setw(8) << n << std::setprecision(4)
+                << std::setw(16) << before << std::setw(12) << after << std::fixed << std::setprecision(2) << std::setw(9) << before/after << "x"
+                << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+    }
+}
+
+//one configuration of the sampler suite
+struct SamplerConfig {
+    const char* name;
+    PartitionCreator::sampleAlgorithms algorithm;
+    PartitionCreator::activeRestrictions restriction;
+    RandomPartition::storageTypes storage;
+    bool skip_sampling;
+    bool odd_distinct;
+};
+
+static const SamplerConfig sampler_configs[] = {
+    {"rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::none, RandomPartition::dense, false, false},
+    {"div_conquer_deterministic", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::dense, false, false},
+    {"self_similar_div_conquer", PartitionCreator::self_similar_div_conquer, PartitionCreator::none, RandomPartition::sparse, true, false},
+    {"exact_table", PartitionCreator::exact_table, PartitionCreator::none, RandomPartition::dense, false, false},
+    {"poisson_process", PartitionCreator::poisson_process, PartitionCreator::none, RandomPartition::sparse, false, false},
+    {"odd_distinct", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::dense, false, true},
+    //only leaves the piece of size 1 out, so its attempts grow about as n^(3/4) next to the flat ones of odd_distinct
+    {"odd_distinct_poisson", PartitionCreator::poisson_process, PartitionCreator::none, RandomPartition::sparse, false, true},
+    {"odd_parts", PartitionCreator::div_conquer_deterministic, PartitionCreator::odd_parts, RandomPartition::dense, false, false},
+};
+
+//measurements of one sampler at one size
+struct SamplerResult {
+    std::string sampler;
+    long long n;
+    long long samples;
+    double seconds;
+    double attempts_per_sample;
+    double ns_per_attempt;
+    long long peak_rss_kb;
+    //the run hit the time limit before finishing a single sample
+    bool timed_out;
+    
+    double samplesPerSecond() const { return seconds > 0 ? samples/seconds : 0.0; }
+};
+
+static long long peakResidentKilobytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+//generates samples until min_seconds have passed, and writes samples, seconds, attempts and peak memory to the pipe
+static void runSamplerCell(const SamplerConfig& config, int n, double min_seconds, const std::string& count_cache, int pipe_out) {
+    //each cell is a new process, which picks up the counts earlier cells saved
+    if (!count_cache.empty())
+        PartitionCountTable::shared().setCacheFile(count_cache);
+    
+    PartitionCreator creator;
+    creator.seed(12345);
+    creator.setRestriction(config.restriction);
+    creator.setStorage(config.storage);
+    creator.setSkipSampling(config.skip_sampling);
+    RandomPartition output(config.storage);
+    
+    long long samples = 0;
+    double elapsed = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        if (config.odd_distinct)
+            creator.generateOddDistinct(output, n, config.algorithm);
+        else
+            creator.generateRandomPartition(output, n, config.algorithm);
+        ++samples;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    
+    std::ostringstream report;
+    report << samples << " " << std::setprecision(17) << elapsed << " " << creator.attemptCount() << " " << peakResidentKilobytes();
+    std::string text = report.str();
+    if (write(pipe_out, text.c_str(), text.size()) < 0)
+        _exit(1);
+}
+
+//runs one cell in a child process, so that peak memory is measured per cell and a sampler that does not finish can be killed
+static SamplerResult measureSampler(const SamplerConfig& config, int n, double min_seconds, unsigned int time_limit, const std::string& count_cache) {
+    SamplerResult result;
+    result.sampler = config.name;
+    result.n = n;
+    result.samples = 0;
+    result.seconds = 0.0;
+    result.attempts_per_sample = 0.0;
+    result.ns_per_attempt = 0.0;
+    result.peak_rss_kb = 0;
+    result.timed_out = true;
+    
+    int channel[2];
+    if (pipe(channel) != 0)
+        return result;
+    std::cout.flush();
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(channel[0]);
+        alarm(time_limit);
+        runSamplerCell(config, n, min_seconds, count_cache, channel[1]);
+        _exit(0);
+    }
+    close(channel[1]);
+    
+    std::string text;
+    char buffer[256];
+    ssize_t length;
+    while ((length = read(channel[0], buffer, sizeof(buffer))) > 0)
+        text.append(buffer, length);
+    close(channel[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    
+    unsigned long long attempts = 0;
+    std::istringstream report(text);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && report >> result.samples >> result.seconds >> attempts >> result.peak_rss_kb)
+    {
+        result.timed_out = false;
+        result.attempts_per_sample = (double)attempts/result.samples;
+        result.ns_per_attempt = result.seconds*1e9/attempts;
+    }
+    return result;
+}
+
+static void writeSamplerJson(std::ostream& out, const std::vector<SamplerResult>& results) {
+    out << "{" << std::endl;
+    out << "  \"benchmark\": \"samplers\"," << std::endl;
+    out << "  \"kernel\": \"" << geometricKernelName() << "\"," << std::endl;
+    out << "  \"results\": [" << std::endl;
+    out << std::setprecision(6);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SamplerResult& r = results[i];
+        //one result per line, which is what readSamplerBaseline() expects
+        out << "    {\"sampler\": \"" << r.sampler << "\", \"n\": " << r.n << ", \"timed_out\": " << (r.timed_out ? "true" : "false")
+            << ", \"samples\": " << r.samples << ", \"seconds\": " << r.seconds << ", \"samples_per_second\": " << r.samplesPerSecond()
+            << ", \"attempts_per_sample\": " << r.attempts_per_sample << ", \"ns_per_attempt\": " << r.ns_per_attempt
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
+
+//value of "key": in a line written by writeSamplerJson(), as text
+static std::string jsonField(const std::string& line, const std::string& key) {
+    size_t position = line.find("\"" + key + "\": ");
+    if (position == std::string::npos)
+        return "";
+    position += key.size() + 4;
+    if (position < line.size() && line[position] == '"')
+        return line.substr(position + 1, line.find('"', position + 1) - position - 1);
+    return line.substr(position, line.find_first_of(",}", position) - position);
+}
+
+//cells with fewer samples, in the run or in the baseline, are too noisy to compare
+static const long long min_compared_samples = 10;
+
+//the figures of one baseline run that the suite compares against
+struct SamplerReference {
+    long long samples;
+    double samples_per_second;
+    double attempts_per_sample;
+};
+
+//every finished run in a file written by writeSamplerJson(), keyed by sampler and n. kernel receives the multiplicity
+//kernel the file was measured with, empty if it does not say.
+static std::map<std::pair<std::string,long long>, SamplerReference> readSamplerBaseline(const std::string& filename, std::string& kernel) {
+    std::map<std::pair<std::string,long long>, SamplerReference> baseline;
+    std::ifstream file(filename.c_str());
+    std::string line;
+    kernel.clear();
+    while (std::getline(file, line))
+    {
+        if (kernel.empty())
+            kernel = jsonField(line, "kernel");
+        std::string sampler = jsonField(line, "sampler");
+        if (sampler.empty() || jsonField(line, "timed_out") == "true")
+            continue;
+        SamplerReference reference;
+        reference.samples = atoll(jsonField(line, "samples").c_str());
+        reference.samples_per_second = atof(jsonField(line, "samples_per_second").c_str());
+        reference.attempts_per_sample = atof(jsonField(line, "attempts_per_sample").c_str());
+        baseline[std::make_pair(sampler, atoll(jsonField(line, "n").c_str()))] = reference;
+    }
+    return baseline;
+}
+
+//runs the suite and returns the number of regressions against the baseline
+int samplerBenchmark(bool quick, const std::string& json_file, const std::string& baseline_file, double tolerance, const std::string& count_cache) {
+    const int largest_n = quick ? 10000 : 100000000;
+    const double min_seconds = quick ? 0.2 : 1.0;
+    //a cell is killed after this long, and a sampler is not run at the next size if that would likely take longer
+    const unsigned int time_limit = quick ? 10 : 60;
+    
+    std::map<std::pair<std::string,long long>, SamplerReference> baseline;
+    if (!baseline_file.empty())
+    {
+        std::string baseline_kernel;
+        baseline = readSamplerBaseline(baseline_file, baseline_kernel);
+        if (baseline.empty())
+            std::cout << "no results in baseline " << baseline_file << std::endl;
+        //the dense samplers spend most of their time in the kernel, so their figures only carry over to the same one
+        else if (!baseline_kernel.empty() && baseline_kernel != geometricKernelName())
+        {
+            std::cout << "baseline " << baseline_file << " was measured with the " << baseline_kernel << " kernel and this host uses "
+                << geometricKernelName() << ", not compared" << std::endl;
+            baseline.clear();
+        }
+    }
+    
+    std::cout << "sampler suite, n = 20 to " << largest_n << ", partition counts cached in " << (count_cache.empty() ? "no file" : count_cache) << std::endl;
+    std::cout << "  " << std::left << std::setw(28) << "sampler" << std::right << std::setw(10) << "n" << std::setw(14) << "samples/s"
+        << std::setw(14) << "attempts" << std::setw(14) << "ns/attempt" << std::setw(12) << "peak MB" << std::setw(12) << "vs base" << std::setw(16) << "attempts base" << std::endl;
+    
+    std::vector<SamplerResult> results;
+    int regressions = 0;
+    for (size_t c = 0; c < sizeof(sampler_configs)/sizeof(sampler_configs[0]); ++c)
+    {
+        const SamplerConfig& config = sampler_configs[c];
+        //seconds per sample at the previous size, 0 before the first
+        double previous_per_sample = 0.0;
+        long long previous_n = 0;
+        for (long long n = 20; n <= largest_n; n = (n == 20) ? 100 : n*10)
+        {
+            SamplerResult result = measureSampler(config, (int)n, min_seconds, time_limit, count_cache);
+            results.push_back(result);
+            
+            std::cout << "  " << std::left << std::setw(28) << config.name << std::right << std::setw(10) << n;
+            if (result.timed_out)
+            {
+                std::cout << "  no sample within " << time_limit << " s, larger sizes skipped" << std::endl;
+                break;
+            }
+            std::cout << std::setprecision(4) << std::setw(14) << result.samplesPerSecond() << std::setw(14) << result.attempts_per_sample
+                << std::setw(14) << result.ns_per_attempt << std::fixed << std::setprecision(1) << std::setw(12) << result.peak_rss_kb/1024.0;
+            
+            std::map<std::pair<std::string,long long>, SamplerReference>::const_iterator reference = baseline.find(std::make_pair(result.sampler, n));
+            if (reference != baseline.end() && reference->second.samples_per_second > 0
+                && reference->second.samples >= min_compared_samples && result.samples >= min_compared_samples)
+            {
+                double ratio = result.samplesPerSecond()/reference->second.samples_per_second;
+                //above 1 when fewer attempts are rejected than in the baseline
+                double attempt_ratio = reference->second.attempts_per_sample/result.attempts_per_sample;
+                std::cout << std::setprecision(2) << std::setw(11) << ratio << "x" << std::setw(15) << attempt_ratio << "x";
+                if (ratio < 1.0 - tolerance)
+                {
+                    std::cout << "  REGRESSION";
+                    ++regressions;
+                }
+            }
+            //back to the stream defaults, which the messages below and the summary print with
+            std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+            
+            //samplers grow anywhere from about sqrt(n), with skip sampling or the Poisson process, to worse than linear, so
+            //the next size is extrapolated from the growth measured between the last two. Short cells at small sizes are
+            //dominated by fixed costs and may underestimate it, which at worst costs one cell that hits the time limit.
+            double per_sample = result.seconds/result.samples;
+            long long next_n = (n == 20) ? 100 : n*10;
+            double exponent = 1.0;
+            if (previous_per_sample > 0)
+                exponent = std::max(0.0, log(per_sample/previous_per_sample)/log((double)n/previous_n));
+            previous_per_sample = per_sample;
+            previous_n = n;
+            if (per_sample*pow((double)next_n/n, exponent) > time_limit)
+            {
+                std::cout << "  " << std::left << std::setw(28) << config.name << std::right << "  larger sizes skipped, a sample would take more than " << time_limit << " s" << std::endl;
+                break;
+            }
+        }
+    }
+    
+    if (!json_file.empty())
+    {
+        std::ofstream out(json_file.c_str());
+        writeSamplerJson(out, results);
+        std::cout << "results written to " << json_file << std::endl;
+    }
+    if (!baseline.empty())
+        std::cout << regressions << " regression(s) against " << baseline_file << " with tolerance " << tolerance << std::endl;
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    bool kernel = false, writer = false, sweep = false, reduce = false, shape = false, tuning = false, samplers = false, quick = false;
+    std::string json_file, baseline_file, count_cache = "partition_counts.pcnt";
+    double tolerance = 0.25;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--kernel")
+            kernel = true;
+        else if (argument == "--writer")
+            writer = true;
+        else if (argument == "--sweep")
+            sweep = true;
+        else if (argument == "--reduce")
+            reduce = true;
+        else if (argument == "--shape")
+            shape = true;
+        else if (argument == "--tuning")
+            tuning = true;
+        else if (argument == "--samplers")
+            samplers = true;
+        else if (argument == "--quick")
+            quick = true;
+        else if (argument == "--json" && i + 1 < argc)
+            json_file = argv[++i];
+        else if (argument == "--baseline" && i + 1 < argc)
+            baseline_file = argv[++i];
+        else if (argument == "--tolerance" && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if (argument == "--count-cache" && i + 1 < argc)
+            count_cache = argv[++i];
+        else
+        {
+            std::cout << "usage: " << argv[0] << " [--kernel] [--writer] [--sweep] [--reduce] [--shape] [--tuning] [--samplers] [--quick] [--json file] [--baseline file] [--tolerance fraction] [--count-cache file]" << std::endl;
+            return 2;
+        }
+    }
+    if (!kernel && !writer && !sweep && !reduce && !shape && !tuning && !samplers)
+        kernel = writer = sweep = reduce = shape = tuning = samplers = true;
+    
+    if (kernel)
+        kernelBenchmark();
+    if (writer)
+        writerBenchmark();
+    if (sweep)
+        sweepBenchmark(quick);
+    if (reduce)
+        reduceBenchmark(quick);
+    if (shape)
+        shapeBenchmark(quick);
+    if (tuning)
+        tuningBenchmark(quick);
+    int regressions = 0;
+    if (samplers)
+        regressions = samplerBenchmark(quick, json_file, baseline_file, tolerance, count_cache);
+    return regressions > 0 ? 1 : 0;
+}
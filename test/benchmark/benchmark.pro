@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# Console benchmarks for the partition samplers
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = benchmark
+TEMPLATE = app
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+# Uncomment to collect PartitionCreator::stats(). Timings then include the instrumentation.
+# DEFINES += PARTITION_CREATOR_STATS
+
+SOURCES += benchmark.cpp \
+    ../PartitionCreator.cpp \
+    ../MultiplicityKernel.cpp \
+    ../PartitionCountTable.cpp \
+    ../PartitionStatistics.cpp \
+    ../PartitionShape.cpp \
+    ../PartitionWriter.cpp
+
+HEADERS  += \
+    ../PartitionCreator.h \
+    ../RestrictionPolicy.h \
+    ../MultiplicityKernel.h \
+    ../PartitionCountTable.h \
+    ../PartitionStatistics.h \
+    ../PartitionShape.h \
+    ../PartitionWriter.h
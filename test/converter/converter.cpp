@@ -0,0 +1,138 @@
+//
+//  converter.cpp
+//  ProbabilisticRejection
+//
+//  Converts text partition files, as written by appendToFile() and PartitionWriter, to indexed binary corpus files.
+//
+//  usage: converter file.txt [file.txt ...]
+//
+//  Every input file.txt is written to file.corpus next to it. The corpus is then read back through PartitionCorpus
+//  and every record formatted as text again, which must reproduce the input line for line.
+//
+
+#include "PartitionCorpus.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//parses one "m1,m2,...,@" line into the partition size and its nonzero multiplicities
+static bool parseLine(const std::string& line, unsigned long long& size, std::vector<std::pair<unsigned long long,unsigned long long> >& pairs) {
+    pairs.clear();
+    size = 0;
+    unsigned long long value = 0;
+    bool digits = false;
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        char c = line[i];
+        if (c >= '0' && c <= '9')
+        {
+            value = value*10 + (c - '0');
+            digits = true;
+        }
+        else if (c == ',')
+        {
+            if (!digits)
+                return false;
+            ++size;
+            if (value != 0)
+                pairs.push_back(std::make_pair(size, value));
+            value = 0;
+            digits = false;
+        }
+        else if (c == '@')
+            return !digits;
+        else if (c != '\r')
+            return false;
+    }
+    return false;
+}
+
+
+static bool convert(const std::string& input_name) {
+    std::string base = input_name;
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".txt") == 0)
+        base.erase(base.size() - 4);
+    std::string output_name = base + ".corpus";
+
+    std::ifstream input(input_name.c_str());
+    if (!input.is_open())
+    {
+        std::cout << input_name << ": cannot open" << std::endl;
+        return false;
+    }
+
+    PartitionCorpusWriter writer(output_name);
+    std::string line;
+    std::vector<std::pair<unsigned long long,unsigned long long> > pairs;
+    unsigned long long size;
+    unsigned long long line_number = 0;
+    unsigned long long text_bytes = 0;
+    while (std::getline(input, line))
+    {
+        ++line_number;
+        text_bytes += line.size() + 1;
+        if (line.empty() || line == "\r")
+            continue;
+        if (!parseLine(line, size, pairs))
+        {
+            std::cout << input_name << ":" << line_number << ": not a partition record" << std::endl;
+            return false;
+        }
+        writer.write(size, pairs);
+    }
+    if (!writer.close())
+    {
+        std::cout << output_name << ": write failed" << std::endl;
+        return false;
+    }
+
+    //read the corpus back and compare every record with the line it came from
+    PartitionCorpus corpus(output_name);
+    if (!corpus.isOpen() || corpus.recordCount() != writer.recordCount())
+    {
+        std::cout << output_name << ": cannot read back" << std::endl;
+        return false;
+    }
+    input.clear();
+    input.seekg(0);
+    RandomPartition64 partition(RandomPartition64::sparse);
+    std::string formatted;
+    for (size_t k = 0; k < corpus.recordCount(); )
+    {
+        std::getline(input, line);
+        if (!line.empty() && line[line.size()-1] == '\r')
+            line.erase(line.size()-1);
+        if (line.empty())
+            continue;
+        corpus.read(k, partition);
+        formatted.clear();
+        formatPartition(formatted, partition);
+        if (formatted != line + "\n")
+        {
+            std::cout << output_name << ": record " << k << " does not match its text line" << std::endl;
+            return false;
+        }
+        ++k;
+    }
+
+    std::ifstream output(output_name.c_str(), std::ios::binary | std::ios::ate);
+    std::cout << input_name << ": " << corpus.recordCount() << " records, " << text_bytes << " -> " << output.tellg() << " bytes" << std::endl;
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "usage: " << argv[0] << " file.txt [file.txt ...]" << std::endl;
+        return 1;
+    }
+
+    bool success = true;
+    for (int i = 1; i < argc; ++i)
+        success = convert(argv[i]) && success;
+    return success ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Converts text partition files to binary corpus files
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = converter
+TEMPLATE = app
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += converter.cpp \
+    ../PartitionCreator.cpp \
+    ../MultiplicityKernel.cpp \
+    ../PartitionCountTable.cpp \
+    ../PartitionStatistics.cpp \
+    ../PartitionCorpus.cpp
+
+HEADERS  += \
+    ../PartitionCreator.h \
+    ../MultiplicityKernel.h \
+    ../PartitionCountTable.h \
+    ../PartitionStatistics.h \
+    ../PartitionCorpus.h
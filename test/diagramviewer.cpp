@@ -0,0 +1,213 @@
+#include "diagramviewer.h"
+#include "PartitionShape.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//samples kept ready ahead of the one shown
+static const int prefetch_depth=3;
+
+std::vector<myrect*> display_parition(std::vector<int> partition,QGraphicsScene* scene){
+    int box_length=20;
+
+    //asuming the element in the vector are sorted so the last
+    //element is the largest
+    int par_size=partition.size();
+    std::vector<myrect*> result;
+    for(int i=par_size;i>0;--i){
+        for(int j=0;j<partition[i-1];++j){
+            int row=par_size-i;
+            int col=j;
+            result.push_back(new myrect(col*box_length,row*box_length,box_length,box_length));
+            scene->addItem(result.back());
+        }
+    }
+
+
+    return result;
+}
+
+bool render_scene(QGraphicsScene* scene,const QString& file){
+    QElapsedTimer timer;
+    timer.start();
+    QRectF bounds=scene->sceneRect();
+    int width=1024;
+    int height=std::max(1,(int)(width*bounds.height()/bounds.width()));
+    QImage image(width,height,QImage::Format_RGB32);
+    QPainter painter(&image);
+    scene->render(&painter,QRectF(0,0,width,height),bounds);
+    painter.end();
+    bool saved=image.save(file);
+    std::cout<<"rendered "<<width<<"x"<<height<<" in "<<timer.elapsed()<<" ms"<<std::endl;
+    return saved;
+}
+
+partitionworker::partitionworker(const std::atomic<int>* current_request):current_request(current_request)
+{
+    creator.setStorage(RandomPartition64::sparse);
+    creator.setSkipSampling(true);
+}
+
+void partitionworker::generate(qint64 size,int request,int count){
+    const std::atomic<int>* current=current_request;
+    state.cancel_check=[current,request](){ return request!=current->load(); };
+    if(plan.goal_size!=size)
+        plan=creator.makePlan(size,PartitionCreator64::self_similar_div_conquer);
+
+    RandomPartition64 partition(RandomPartition64::sparse);
+    for(int i=0;i<count;++i){
+        QElapsedTimer timer;
+        timer.start();
+        //false once the request is cancelled, even in the middle of the sample
+        if(!creator.generateRandomPartition(partition,plan,state))
+            return;
+        diagramrows rows;
+        diagramRows(partition,rows);
+        //the request may have been cancelled while the rows were made
+        if(request!=current_request->load())
+            return;
+        emit sample_ready(request,size,rows,timer.elapsed());
+    }
+}
+
+diagramviewer::diagramviewer(QGraphicsScene* scene,QGraphicsView* view,bool cells,QString render_file):
+    scene(scene),view(view),current_request(0),outstanding(0),waiting(false),size(0),fitted(false),
+    cells(cells),render_file(render_file),last_milliseconds(0)
+{
+    qRegisterMetaType<diagramrows>("diagramrows");
+
+    //the worker lives on its own thread, so both connections are queued
+    worker=new partitionworker(&current_request);
+    worker->moveToThread(&thread);
+    connect(&thread,&QThread::finished,worker,&QObject::deleteLater);
+    connect(this,&diagramviewer::samples_wanted,worker,&partitionworker::generate);
+    connect(worker,&partitionworker::sample_ready,this,&diagramviewer::sample_ready);
+    thread.start();
+}
+
+diagramviewer::~diagramviewer(){
+    ++current_request;
+    thread.quit();
+    thread.wait();
+}
+
+void diagramviewer::request_size(long long size){
+    //a myrect per cell stalls the scene long before the sampler does
+    if(cells && size>max_cells_size)
+        std::cerr<<"drawing cells is only practical up to size "<<max_cells_size<<", size "<<size<<" is drawn as one diagram"<<std::endl;
+    cancel();
+    this->size=size;
+    fitted=false;
+    waiting=true;
+    refill();
+    update_title();
+}
+
+void diagramviewer::refill(){
+    if(size<=0)
+        return;
+    int wanted=prefetch_depth+(waiting ? 1 : 0)-(int)prefetched.size()-outstanding;
+    if(wanted>0){
+        outstanding+=wanted;
+        emit samples_wanted(size,current_request.load(),wanted);
+    }
+}
+
+void diagramviewer::show_next(){
+    if(prefetched.empty())
+        waiting=true;
+    else{
+        show(prefetched.front());
+        prefetched.pop_front();
+    }
+    refill();
+    update_title();
+}
+
+void diagramviewer::cancel(){
+    //the worker's sampler stops at its next attempt, and anything it already sent is dropped on arrival
+    ++current_request;
+    prefetched.clear();
+    outstanding=0;
+    waiting=false;
+    update_title();
+}
+
+void diagramviewer::sample_ready(int request,qint64,diagramrows rows,qint64 milliseconds){
+    if(request!=current_request.load())
+        return;
+    --outstanding;
+    last_milliseconds=milliseconds;
+    if(waiting){
+        waiting=false;
+        show(rows);
+    }
+    else
+        prefetched.push_back(rows);
+    refill();
+    update_title();
+}
+
+void diagramviewer::show(const diagramrows& rows){
+    scene->clear();
+    if(cells && size<=max_cells_size){
+        //the parts in ascending order, as display_parition expects
+        std::vector<int> parts;
+        for(size_t i=rows.size();i-->0;)
+            parts.insert(parts.end(),rows[i].second,(int)rows[i].first);
+        display_parition(parts,scene);
+    }
+    else
+        scene->addItem(new youngdiagram(rows));
+    scene->setSceneRect(scene->itemsBoundingRect());
+
+    //keep the zoom and position of the previous sample of the same size
+    if(!fitted){
+        view->fitInView(scene->sceneRect(),Qt::KeepAspectRatio);
+        fitted=true;
+    }
+
+    if(!render_file.isEmpty())
+        QCoreApplication::exit(render_scene(scene,render_file) ? 0 : 1);
+}
+
+void diagramviewer::update_title(){
+    QString title=QString("partition of %1").arg(size);
+    if(waiting)
+        title+=", generating";
+    else if(outstanding==0 && prefetched.empty())
+        title+=", stopped";
+    else
+        title+=QString(", generated in %1 ms, %2 ready").arg(last_milliseconds).arg(prefetched.size());
+    view->setWindowTitle(title);
+}
+
+diagramview::diagramview():viewer(0)
+{
+    setDragMode(QGraphicsView::ScrollHandDrag);
+    setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+}
+
+void diagramview::set_viewer(diagramviewer* viewer){
+    this->viewer=viewer;
+}
+
+void diagramview::wheelEvent(QWheelEvent* event){
+    qreal factor=std::pow(1.0015,event->angleDelta().y());
+    scale(factor,factor);
+}
+
+void diagramview::keyPressEvent(QKeyEvent* event){
+    if(viewer && (event->key()==Qt::Key_N || event->key()==Qt::Key_Space))
+        viewer->show_next();
+    else if(viewer && event->key()==Qt::Key_Escape)
+        viewer->cancel();
+    else
+        QGraphicsView::keyPressEvent(event);
+}
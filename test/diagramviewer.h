@@ -0,0 +1,135 @@
+#ifndef DIAGRAMVIEWER_H
+#define DIAGRAMVIEWER_H
+
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "rect.h"
+#include "PartitionCreator.h"
+
+/** The rows of a diagram from the top row down, as (row length, row count) pairs made by diagramRows() */
+typedef std::vector<std::pair<long long,long long> > diagramrows;
+Q_DECLARE_METATYPE(diagramrows)
+
+class diagramviewer;
+
+/** This function helps display the partition
+ * @param partition is the vector that contains the integer partition
+ * @param scene is the pointer to QGraphicsScene
+ * @returns a vector of pointers to myrect, one per cell
+*/
+std::vector<myrect*> display_parition(std::vector<int> partition,QGraphicsScene* scene);
+
+/** This function draws the whole scene into an image file 1024 pixels wide
+ * @returns whether the file could be written
+*/
+bool render_scene(QGraphicsScene* scene,const QString& file);
+
+/** Generates partitions on its own thread and sends each one back as the rows of its diagram.
+ * Requests are numbered, and a request stops as soon as it is no longer the current one, even in the middle of a
+ * sample, as the sampler checks the request before every attempt.
+*/
+class partitionworker:public QObject{
+    Q_OBJECT
+public:
+    /** @param current_request is the number of the request the viewer still wants samples for */
+    partitionworker(const std::atomic<int>* current_request);
+
+public slots:
+    /** Generates count partitions of size, sending each one as soon as it is ready */
+    void generate(qint64 size,int request,int count);
+
+signals:
+    void sample_ready(int request,qint64 size,diagramrows rows,qint64 milliseconds);
+
+private:
+    const std::atomic<int>* current_request;
+    PartitionCreator64 creator;
+    //plan of the last size, kept while samples of it are asked for
+    SamplerPlan64 plan;
+    //its cancel check stops the sampler once the request it was set for is no longer current
+    SamplerState state;
+};
+
+/** Shows random partitions of one size at a time. They are generated on a worker thread and reach the scene through
+ * queued signals, so the window stays responsive while sampling. A few samples are kept ready ahead, so the next one
+ * is usually shown at once.
+*/
+class diagramviewer:public QObject{
+    Q_OBJECT
+public:
+    /** @param cells is whether to draw one myrect per cell instead of one youngdiagram per partition
+     * @param render_file is an image file the first partition is rendered into before quitting, or empty to keep showing
+    */
+    diagramviewer(QGraphicsScene* scene,QGraphicsView* view,bool cells=false,QString render_file=QString());
+    /** Stops the worker thread, waiting for the sample in progress */
+    ~diagramviewer();
+
+    /** Largest size drawn cell by cell, larger ones are drawn as one youngdiagram even with cells */
+    static const long long max_cells_size=5000;
+
+    /** Starts showing partitions of size, dropping every sample of the previous size */
+    void request_size(long long size);
+
+public slots:
+    /** Shows the next partition, a prefetched one if there is one, or else the next to arrive */
+    void show_next();
+    /** Drops the samples in progress and the prefetched ones. show_next() starts generating again. */
+    void cancel();
+
+signals:
+    void samples_wanted(qint64 size,int request,int count);
+
+private slots:
+    void sample_ready(int request,qint64 size,diagramrows rows,qint64 milliseconds);
+
+private:
+    /** Asks the worker for enough samples to have prefetch_depth ready, plus one if a sample is awaited */
+    void refill();
+    /** Replaces the scene with a diagram */
+    void show(const diagramrows& rows);
+    void update_title();
+
+    QGraphicsScene* scene;
+    QGraphicsView* view;
+    QThread thread;
+    partitionworker* worker;
+    //samples of other requests are dropped on arrival
+    std::atomic<int> current_request;
+    std::deque<diagramrows> prefetched;
+    //samples asked of the worker for the current request and not yet arrived
+    int outstanding;
+    //a sample was asked for before one was ready, the next to arrive is shown
+    bool waiting;
+    long long size;
+    bool fitted;
+    bool cells;
+    QString render_file;
+    qint64 last_milliseconds;
+};
+
+/** A view that zooms around the mouse on the wheel and pans by dragging. N or space shows the next sample of the viewer
+ * and escape cancels it.
+*/
+class diagramview:public QGraphicsView{
+public:
+    diagramview();
+    void set_viewer(diagramviewer* viewer);
+
+protected:
+    void wheelEvent(QWheelEvent* event);
+    void keyPressEvent(QKeyEvent* event);
+
+private:
+    diagramviewer* viewer;
+};
+
+
+#endif // DIAGRAMVIEWER_H
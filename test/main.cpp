@@ -1,5 +1,14 @@
-/*This is just a test of using qt to display young diagram, the assumption is that the partition is passed in a sorted
- * vector in ascending order
+/*This is just a test of using qt to display young diagram.
+ *
+ * usage: test [size] [--cells] [--render file.png]
+ *
+ * Without a size the small example partition below is shown cell by cell. With a size random partitions of it are
+ * generated with self similar divide and conquer on a worker thread and drawn as one youngdiagram item each, which
+ * stays interactive up to sizes of 10^7 and more: drag to pan, wheel to zoom, N or space for the next sample, escape
+ * to cancel. --cells draws one myrect per cell instead, which is only practical for small sizes, so sizes above 5000
+ * are still drawn as one diagram, with a warning. --render draws the first partition into an image file and exits
+ * without opening a window, which also works headless with the offscreen platform:
+ * test -platform offscreen 10000000 --render diagram.png
 */
 
 
@@ -7,40 +16,16 @@
 #include <QGraphicsView>
 #include <QGraphicsRectItem>
 #include <QGraphicsScene>
+#include <QStringList>
 //#include <QDebug>
 #include <vector>
 #include "rect.h"
-
-/** This function helps display the partition
- * @param partition is the vector that contains the integer partition
- * @param scene is the pointer to QGraphicsScene
- * @returns a vector of pointers to myrect
-*/
-std::vector<myrect*> display_parition(std::vector<int> partition,QGraphicsScene* scene){
-    int box_length=20;
-
-    //asuming the element in the vector are sorted so the last
-    //element is the largest
-    int par_size=partition.size();
-    int max_col=partition[par_size-1];
-    std::vector<myrect*> result(max_col*par_size);
-    for(int i=par_size;i>0;--i){
-        for(int j=0;j<partition[i-1];++j){
-            int row=par_size-i;
-            int col=j;
-            result[row*max_col+col]=new myrect(col*box_length,row*box_length,box_length,box_length);
-            scene->addItem(result[row*max_col+col]);
-        }
-    }
-
-
-    return result;
-}
+#include "diagramviewer.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    QGraphicsView view;
+    diagramview view;
 
     QGraphicsScene* scene = new QGraphicsScene(&view);
 
@@ -49,14 +34,44 @@ int main(int argc, char *argv[])
     //view.resize(400,400);
     scene->setSceneRect(0,0,400,400);
 
-    //can try to revise the values in here and it can display different partition
-    std::vector<int> partition(4);
-    partition[0]=1;
-    partition[1]=3;
-    partition[2]=6;
-    partition[3]=10;
+    //Qt has taken its own options, such as -platform, out of the arguments already
+    QStringList arguments=a.arguments();
+    long long size=0;
+    bool cells=false;
+    QString render_file;
+    for(int i=1;i<arguments.size();++i){
+        if(arguments[i]=="--cells")
+            cells=true;
+        else if(arguments[i]=="--render" && i+1<arguments.size())
+            render_file=arguments[++i];
+        else
+            size=arguments[i].toLongLong();
+    }
+
+    //partitions are generated off the GUI thread and shown as they arrive
+    diagramviewer viewer(scene,&view,cells,render_file);
+    view.set_viewer(&viewer);
+    view.resize(800,600);
 
-    display_parition(partition,scene);
+    if(size<=0){
+        //can try to revise the values in here and it can display different partition
+        std::vector<int> partition(4);
+        partition[0]=1;
+        partition[1]=3;
+        partition[2]=6;
+        partition[3]=10;
+
+        display_parition(partition,scene);
+    }
+    else
+        viewer.request_size(size);
+
+    if(!render_file.isEmpty()){
+        //the example is drawn at once, a random partition once the worker has sent it
+        if(size<=0)
+            return render_scene(scene,render_file) ? 0 : 1;
+        return a.exec();
+    }
 
 
     /*
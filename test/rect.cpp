@@ -1,6 +1,11 @@
 #include "rect.h"
 #include <QPen>
 #include <QBrush>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
 
 myrect::myrect(int x, int y, int w, int h):QGraphicsRectItem(x,y,w,h),
     loc_x(x),loc_y(y),width(w),height(h)
@@ -9,3 +14,73 @@ myrect::myrect(int x, int y, int w, int h):QGraphicsRectItem(x,y,w,h),
     setBrush(QBrush(Qt::yellow));
 }
 
+youngdiagram::youngdiagram(const std::vector<std::pair<long long,long long> >& rows, int box_length):
+    rows(rows),box_length(box_length)
+{
+    run_starts.reserve(rows.size()+1);
+    long long row=0;
+    for(size_t i=0;i<rows.size();++i){
+        run_starts.push_back(row);
+        row+=rows[i].second;
+    }
+    run_starts.push_back(row);
+
+    //paint() only draws what is exposed
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF youngdiagram::boundingRect() const{
+    if(rows.empty())
+        return QRectF();
+    //room for the cell borders on the edges
+    return QRectF(0,0,(qreal)rows[0].first*box_length,(qreal)run_starts.back()*box_length).adjusted(-1,-1,1,1);
+}
+
+void youngdiagram::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*){
+    QRectF exposed=option->exposedRect.intersected(boundingRect());
+    if(rows.empty() || exposed.isEmpty())
+        return;
+
+    //side of one cell in pixels at the current zoom
+    qreal cell_pixels=box_length*QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    //runs are merged until they are this many rows high, so every rectangle is at least a pixel high
+    double merged_rows=cell_pixels<1 ? 1/cell_pixels : 0;
+
+    //visible rows, and the run holding the first of them
+    long long first_row=std::max(0LL,(long long)std::floor(exposed.top()/box_length));
+    long long end_row=std::min(run_starts.back(),(long long)std::ceil(exposed.bottom()/box_length));
+    size_t first_run=std::upper_bound(run_starts.begin(),run_starts.end(),first_row)-run_starts.begin()-1;
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QBrush(Qt::yellow));
+    for(size_t run=first_run;run<rows.size() && run_starts[run]<end_row;){
+        //a merged block is drawn as long as its first run, which covers every run below it
+        size_t next=run+1;
+        while(next<rows.size() && run_starts[next]-run_starts[run]<merged_rows && run_starts[next]<end_row)
+            ++next;
+        qreal top=(qreal)run_starts[run]*box_length;
+        painter->drawRect(QRectF(0,top,(qreal)rows[run].first*box_length,(qreal)run_starts[next]*box_length-top));
+        run=next;
+    }
+
+    //cell borders, only for the visible cells and only once they are large enough to be told apart
+    if(cell_pixels<4)
+        return;
+    long long first_col=std::max(0LL,(long long)std::floor(exposed.left()/box_length));
+    long long end_col=(long long)std::ceil(exposed.right()/box_length);
+    QVector<QLineF> lines;
+    for(size_t run=first_run;run<rows.size() && run_starts[run]<end_row;++run){
+        long long top=std::max(run_starts[run],first_row);
+        long long bottom=std::min(run_starts[run+1],end_row);
+        long long last_col=std::min(rows[run].first,end_col);
+        if(last_col<first_col)
+            continue;
+        //the top edge of every row, and the bottom edge of the run
+        for(long long row=top;row<=bottom;++row)
+            lines.append(QLineF(first_col*box_length,row*box_length,last_col*box_length,row*box_length));
+        for(long long col=first_col;col<=last_col;++col)
+            lines.append(QLineF(col*box_length,top*box_length,col*box_length,bottom*box_length));
+    }
+    painter->setPen(QPen(QColor(Qt::white),0));
+    painter->drawLines(lines);
+}
@@ -2,6 +2,8 @@
 #define RECT_H
 
 #include <QGraphicsItem>
+#include <utility>
+#include <vector>
 
 
 class myrect:public QGraphicsRectItem{
@@ -16,5 +18,27 @@ private:
 
 };
 
+/** A whole Young diagram drawn as one item, with each run of equal rows painted as one rectangle.
+ * Zoomed in far enough for the cells to be seen, the cells in the exposed area get their borders. Further out the
+ * runs are filled without borders, and runs thinner than a pixel are merged with the runs below them, so a paint
+ * costs at most one rectangle per pixel row on screen whatever the size of the partition.
+ */
+class youngdiagram:public QGraphicsItem{
+public:
+    /** @param rows is the (row length, row count) pairs from the top row down, as made by diagramRows()
+     * @param box_length is the side of one cell in scene coordinates
+    */
+    youngdiagram(const std::vector<std::pair<long long,long long> >& rows, int box_length=20);
+
+    QRectF boundingRect() const;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
+
+private:
+    std::vector<std::pair<long long,long long> > rows;
+    //first row of every run, followed by the number of rows
+    std::vector<long long> run_starts;
+    int box_length;
+};
+
 
 #endif // RECT_H
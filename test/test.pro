@@ -10,10 +10,24 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = test
 TEMPLATE = app
+CONFIG += c++14
 
 
 SOURCES += main.cpp \
-    rect.cpp
+    rect.cpp \
+    diagramviewer.cpp \
+    PartitionCreator.cpp \
+    MultiplicityKernel.cpp \
+    PartitionCountTable.cpp \
+    PartitionStatistics.cpp \
+    PartitionShape.cpp
 
 HEADERS  += \
-    rect.h
+    rect.h \
+    diagramviewer.h \
+    PartitionCreator.h \
+    RestrictionPolicy.h \
+    MultiplicityKernel.h \
+    PartitionCountTable.h \
+    PartitionStatistics.h \
+    PartitionShape.h
@@ -0,0 +1,703 @@
+//
+//  validation.cpp
+//  ProbabilisticRejection
+//
+//  Statistical validation of the partition samplers. Every sampler should produce each partition of n in its class
+//  with equal probability, which is checked at three scales:
+//
+//  - small n: every partition is enumerated and the empirical frequencies are compared with the uniform
+//    distribution by a chi-square test
+//  - moderate n: the distribution of the largest part, and for unrestricted partitions of the number of parts, is
+//    computed exactly by dynamic programming and compared with the empirical one by a chi-square test on bins
+//    Unrestricted samplers are run a second time through generateStatistics(), checking the streamed largest part
+//    law the same way and the streamed mean number of parts against its exact value by a z-test
+//  - large n: the largest part and the number of parts, suitably scaled, tend to the Gumbel law. They are compared
+//    with it by a Kolmogorov-Smirnov test. Only samplers fast enough at that size are run there.
+//
+//  Samples are drawn on every hardware thread, each with its own random stream. Plain samplers share one creator and
+//  plan across the threads through the const generateRandomPartition(), with a SamplerState per thread.
+//
+//  usage: validation [--quick] [--scale factor] [--threads count] [--seed value] [--alpha level] [--only name]
+//
+//  --quick and --scale shrink or grow every sample count (--quick is --scale 0.1). A test fails when its p-value is
+//  below alpha (default 1e-4). The exit status is 1 if any test failed.
+//
+
+#include "PartitionCreator.h"
+#include "PartitionStatistics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum partClasses {all_parts, odd_parts, even_parts, distinct_parts, distinct_odd_parts, bounded_parts};
+
+//largest piece size of the bounded_parts class
+static const int bounded_part_limit = 5;
+
+//one sampler configuration under test
+struct SamplerConfig {
+    const char* name;
+    PartitionCreator::sampleAlgorithms algorithm;
+    PartitionCreator::activeRestrictions restriction;
+    RandomPartition::storageTypes storage;
+    bool skip_sampling;
+    //use generateOddDistinct() instead of generateRandomPartition()
+    bool odd_distinct;
+    //use generateSweep() over the sizes within sweep_radius of n, keeping the partition of n
+    bool sweep;
+    partClasses part_class;
+    //largest scale the sampler is fast enough for: 0 small n only, 1 up to moderate n, 2 also large n
+    int largest_scale;
+};
+
+static const SamplerConfig sampler_configs[] = {
+    {"rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::none, RandomPartition::dense, false, false, false, all_parts, 0},
+    {"rejection_sample/skip", PartitionCreator::rejection_sample, PartitionCreator::none, RandomPartition::sparse, true, false, false, all_parts, 0},
+    {"div_conquer_deterministic", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::dense, false, false, false, all_parts, 1},
+    {"div_conquer_deterministic/skip", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::sparse, true, false, false, all_parts, 2},
+    {"self_similar_div_conquer", PartitionCreator::self_similar_div_conquer, PartitionCreator::none, RandomPartition::sparse, true, false, false, all_parts, 2},
+    {"exact_table", PartitionCreator::exact_table, PartitionCreator::none, RandomPartition::dense, false, false, false, all_parts, 1},
+    {"poisson_process", PartitionCreator::poisson_process, PartitionCreator::none, RandomPartition::sparse, false, false, false, all_parts, 2},
+    {"rejection_sample/sweep", PartitionCreator::rejection_sample, PartitionCreator::none, RandomPartition::dense, false, false, true, all_parts, 0},
+    {"div_conquer_deterministic/sweep", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::dense, false, false, true, all_parts, 1},
+    {"poisson_process/sweep", PartitionCreator::poisson_process, PartitionCreator::none, RandomPartition::sparse, false, false, true, all_parts, 1},
+    {"odd_parts/rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::odd_parts, RandomPartition::dense, false, false, false, odd_parts, 0},
+    {"odd_parts/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::odd_parts, RandomPartition::sparse, true, false, false, odd_parts, 2},
+    {"odd_parts/sweep", PartitionCreator::div_conquer_deterministic, PartitionCreator::odd_parts, RandomPartition::sparse, true, false, true, odd_parts, 1},
+    {"even_parts/rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::even_parts, RandomPartition::dense, false, false, false, even_parts, 0},
+    {"even_parts/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::even_parts, RandomPartition::sparse, true, false, false, even_parts, 2},
+    {"distinct_parts/rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::distinct_parts, RandomPartition::dense, false, false, false, distinct_parts, 0},
+    {"distinct_parts/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::distinct_parts, RandomPartition::sparse, true, false, false, distinct_parts, 1},
+    {"distinct_parts/poisson_process", PartitionCreator::poisson_process, PartitionCreator::distinct_parts, RandomPartition::sparse, false, false, false, distinct_parts, 1},
+    {"distinct_parts/sweep", PartitionCreator::div_conquer_deterministic, PartitionCreator::distinct_parts, RandomPartition::sparse, true, false, true, distinct_parts, 0},
+    {"bounded_parts/rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::none, RandomPartition::dense, false, false, false, bounded_parts, 0},
+    {"bounded_parts/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::sparse, true, false, false, bounded_parts, 1},
+    {"odd_distinct/rejection_sample", PartitionCreator::rejection_sample, PartitionCreator::none, RandomPartition::dense, false, true, false, distinct_odd_parts, 0},
+    {"odd_distinct/div_conquer", PartitionCreator::div_conquer_deterministic, PartitionCreator::none, RandomPartition::sparse, false, true, false, distinct_odd_parts, 1},
+};
+
+static const int small_sizes[] = {10, 20, 30};
+//sizes on each side of n that a sweep covers
+static const int sweep_radius = 8;
+
+static const int moderate_size = 1000;
+static const int large_size = 1000000;
+
+
+//calls visit(part, multiplicity) for every nonzero multiplicity, in increasing part order
+template <typename Visitor>
+static void forEachPart(const RandomPartition& partition, Visitor visit) {
+    if (partition.storage == RandomPartition::dense)
+    {
+        for (size_t i = 1; i < partition.partition_sizes.size(); ++i)
+            if (partition.partition_sizes[i] != 0)
+                visit((int)i, partition.partition_sizes[i]);
+    }
+    else
+    {
+        for (size_t j = 0; j < partition.sparse_parts.size(); ++j)
+            visit(partition.sparse_parts[j].first, partition.sparse_parts[j].second);
+    }
+}
+
+
+static bool partAllowed(partClasses part_class, int part) {
+    switch (part_class) {
+        case odd_parts:
+        case distinct_odd_parts:
+            return part % 2 == 1;
+        case even_parts:
+            return part % 2 == 0;
+        case bounded_parts:
+            return part <= bounded_part_limit;
+        default:
+            return true;
+    }
+}
+
+
+static bool isDistinct(partClasses part_class) {
+    return part_class == distinct_parts || part_class == distinct_odd_parts;
+}
+
+
+//whether a sampled partition is a partition of n in the class at all
+static bool belongsToClass(const RandomPartition& partition, long long n, partClasses part_class) {
+    bool valid = true;
+    long long total = 0;
+    forEachPart(partition, [&](int part, int multiplicity) {
+        total += (long long)part*multiplicity;
+        if (multiplicity < 0 || !partAllowed(part_class, part) || (isDistinct(part_class) && multiplicity > 1))
+            valid = false;
+    });
+    return valid && total == n;
+}
+
+
+//draws count samples spread over threads. Each thread fills its own copy of empty through add(partition), and the
+//copies are combined with merge(). Plain samplers run on one shared creator and plan, each thread with its own sampler
+//state, while odd distinct and sweep configurations give every thread a creator of its own.
+template <typename Accumulator>
+static Accumulator sampleInParallel(const SamplerConfig& config, int n, long long count, const Accumulator& empty, unsigned long long seed, int threads) {
+    PartitionCreator planner;
+    planner.setSkipSampling(config.skip_sampling);
+    const PartitionCreator& shared = planner;
+    const SamplerPlan plan = shared.makePlan(n, config.algorithm, config.restriction, config.part_class == bounded_parts ? bounded_part_limit : 0);
+    
+    std::vector<Accumulator> partial(threads, empty);
+    auto work = [&](int worker_id) {
+        SamplerState state(seed, worker_id);
+        PartitionCreator creator;
+        creator.seed(seed, worker_id);
+        creator.setRestriction(config.restriction, config.part_class == bounded_parts ? bounded_part_limit : 0);
+        creator.setStorage(config.storage);
+        creator.setSkipSampling(config.skip_sampling);
+        RandomPartition output(config.storage);
+        long long share = count/threads + (worker_id < count % threads ? 1 : 0);
+        for (long long s = 0; s < share; ++s)
+        {
+            if (config.odd_distinct)
+                creator.generateOddDistinct(output, n, config.algorithm);
+            else if (config.sweep)
+            {
+                creator.generateSweep(std::max(1, n - sweep_radius), n + sweep_radius, [&](int size, const RandomPartition& partition) {
+                    if (size == n)
+                        output = partition;
+                }, config.algorithm);
+            }
+            else
+                shared.generateRandomPartition(output, plan, state);
+            partial[worker_id].add(output);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.push_back(std::thread(work, t));
+    work(0);
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+
+    Accumulator total = empty;
+    for (int t = 0; t < threads; ++t)
+        total.merge(partial[t]);
+    return total;
+}
+
+
+//regularized upper incomplete gamma function Q(a, x), by its series below a+1 and its continued fraction above
+static double upperGammaRegularized(double a, double x) {
+    if (x <= 0)
+        return 1.0;
+    double log_prefix = a*log(x) - x - lgamma(a);
+    if (x < a + 1)
+    {
+        double term = 1.0/a, sum = term;
+        for (int k = 1; k < 10000 && fabs(term) > fabs(sum)*1e-16; ++k)
+        {
+            term *= x/(a + k);
+            sum += term;
+        }
+        return std::max(0.0, 1.0 - exp(log_prefix)*sum);
+    }
+    //modified Lentz evaluation of the continued fraction
+    const double tiny = 1e-300;
+    double b = x + 1 - a, c = 1/tiny, d = 1/b, h = d;
+    for (int i = 1; i < 10000; ++i)
+    {
+        double an = -i*(i - a);
+        b += 2;
+        d = an*d + b;
+        if (fabs(d) < tiny)
+            d = tiny;
+        c = b + an/c;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1/d;
+        double delta = d*c;
+        h *= delta;
+        if (fabs(delta - 1) < 1e-16)
+            break;
+    }
+    return exp(log_prefix)*h;
+}
+
+
+static double chiSquarePValue(double statistic, int degrees_of_freedom) {
+    return upperGammaRegularized(degrees_of_freedom/2.0, statistic/2.0);
+}
+
+
+//asymptotic p-value of the Kolmogorov-Smirnov statistic d over m samples
+static double kolmogorovPValue(double d, long long m) {
+    double root = sqrt((double)m);
+    double lambda = (root + 0.12 + 0.11/root)*d;
+    if (lambda < 0.2)
+        return 1.0;
+    double sum = 0.0;
+    for (int j = 1; j <= 100; ++j)
+        sum += (j % 2 ? 2.0 : -2.0)*exp(-2.0*j*j*lambda*lambda);
+    return std::min(1.0, std::max(0.0, sum));
+}
+
+
+//outcome of one test
+struct TestResult {
+    std::string config;
+    std::string test;
+    int n;
+    long long samples;
+    double statistic;
+    double p_value;
+    //samples that were not partitions of n in the class
+    long long invalid;
+    double seconds;
+};
+
+
+static bool printResult(const TestResult& result, double alpha) {
+    bool passed = result.invalid == 0 && result.p_value >= alpha;
+    std::cout << "  " << std::left << std::setw(32) << result.config << std::setw(16) << result.test << std::right << std::setw(9) << result.n
+        << std::setw(10) << result.samples << std::setw(12) << std::setprecision(4) << result.statistic << std::setw(12) << result.p_value
+        << std::setw(9) << std::fixed << std::setprecision(1) << result.seconds << "s  " << std::defaultfloat;
+    if (result.invalid > 0)
+        std::cout << "FAIL (" << result.invalid << " samples not in the class)";
+    else
+        std::cout << (passed ? "pass" : "FAIL");
+    std::cout << std::endl;
+    return passed;
+}
+
+
+//every partition of n in a class, as multiplicity vectors of length n+1
+static void enumeratePartitions(int n, partClasses part_class, std::vector<std::vector<int> >& output) {
+    std::vector<int> multiplicities(n + 1, 0);
+    //place pieces of size part or smaller to fill remaining
+    std::function<void(int, int)> place = [&](int remaining, int part) {
+        if (remaining == 0)
+        {
+            output.push_back(multiplicities);
+            return;
+        }
+        if (part == 0)
+            return;
+        int most = partAllowed(part_class, part) ? remaining/part : 0;
+        if (isDistinct(part_class))
+            most = std::min(most, 1);
+        for (int count = most; count >= 0; --count)
+        {
+            multiplicities[part] = count;
+            place(remaining - count*part, part - 1);
+        }
+        multiplicities[part] = 0;
+    };
+    place(n, n);
+}
+
+
+//counts how often each enumerated partition was drawn
+struct FrequencyCounter {
+    const std::map<std::vector<int>, int>* index;
+    int n;
+    partClasses part_class;
+    std::vector<long long> counts;
+    long long invalid;
+    std::vector<int> key;
+
+    void add(const RandomPartition& partition) {
+        if (!belongsToClass(partition, n, part_class))
+        {
+            ++invalid;
+            return;
+        }
+        key.assign(n + 1, 0);
+        forEachPart(partition, [&](int part, int multiplicity) { key[part] = multiplicity; });
+        std::map<std::vector<int>, int>::const_iterator it = index->find(key);
+        if (it == index->end())
+            ++invalid;
+        else
+            ++counts[it->second];
+    }
+
+    void merge(const FrequencyCounter& other) {
+        for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] += other.counts[i];
+        invalid += other.invalid;
+    }
+};
+
+
+//seed of one group of tests, a hash of the run's seed, the sampler, the group and n. It does not depend on which other
+//tests run or in what order, so adding tests or running one sampler with --only leaves the samples of the others alone.
+static unsigned long long testSeed(unsigned long long seed, const std::string& sampler, const std::string& group, long long n) {
+    //64 bit FNV-1a over the names and n, then mixed with the run's seed
+    unsigned long long hash = 14695981039346656037ULL;
+    std::string key = sampler + "/" + group + "/" + std::to_string(n);
+    for (size_t i = 0; i < key.size(); ++i)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (seed*0x9E3779B97F4A7C15ULL);
+}
+
+
+static TestResult smallTest(const SamplerConfig& config, int n, long long samples, unsigned long long seed, int threads) {
+    std::vector<std::vector<int> > partitions;
+    enumeratePartitions(n, config.part_class, partitions);
+    std::map<std::vector<int>, int> index;
+    for (size_t i = 0; i < partitions.size(); ++i)
+        index[partitions[i]] = (int)i;
+
+    FrequencyCounter empty;
+    empty.index = &index;
+    empty.n = n;
+    empty.part_class = config.part_class;
+    empty.counts.assign(partitions.size(), 0);
+    empty.invalid = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FrequencyCounter counter = sampleInParallel(config, n, samples, empty, seed, threads);
+
+    double expected = (double)samples/partitions.size();
+    double statistic = 0.0;
+    for (size_t i = 0; i < partitions.size(); ++i)
+        statistic += (counter.counts[i] - expected)*(counter.counts[i] - expected)/expected;
+
+    TestResult result;
+    result.config = config.name;
+    result.test = "frequencies";
+    result.n = n;
+    result.samples = samples;
+    result.statistic = statistic;
+    result.p_value = partitions.size() > 1 ? chiSquarePValue(statistic, (int)partitions.size() - 1) : 1.0;
+    result.invalid = counter.invalid;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+
+//exact probability that the largest part of a uniform partition of n in the class is m, for every m up to n
+static std::vector<double> largestPartLaw(int n, partClasses part_class) {
+    //after processing part m, ways[j] counts the partitions of j in the class into parts of size m or less
+    std::vector<double> ways(n + 1, 0.0);
+    ways[0] = 1.0;
+    //no partition of n >= 1 has largest part 0
+    std::vector<double> at_most(n + 1, 0.0);
+    for (int m = 1; m <= n; ++m)
+    {
+        if (partAllowed(part_class, m))
+        {
+            if (isDistinct(part_class))
+            {
+                for (int j = n; j >= m; --j)
+                    ways[j] += ways[j-m];
+            }
+            else
+            {
+                for (int j = m; j <= n; ++j)
+                    ways[j] += ways[j-m];
+            }
+        }
+        at_most[m] = ways[n];
+    }
+    std::vector<double> law(n + 1, 0.0);
+    for (int m = 1; m <= n; ++m)
+        law[m] = (at_most[m] - at_most[m-1])/ways[n];
+    return law;
+}
+
+
+//counts the largest part and the number of parts of every sample
+struct PartStatisticsCounter {
+    int n;
+    partClasses part_class;
+    std::vector<long long> largest_part;
+    std::vector<long long> part_count;
+    long long invalid;
+
+    void add(const RandomPartition& partition) {
+        if (!belongsToClass(partition, n, part_class))
+        {
+            ++invalid;
+            return;
+        }
+        int largest = 0;
+        long long parts = 0;
+        forEachPart(partition, [&](int part, int multiplicity) {
+            largest = part;
+            parts += multiplicity;
+        });
+        ++largest_part[largest];
+        ++part_count[parts];
+    }
+
+    void merge(const PartStatisticsCounter& other) {
+        for (size_t i = 0; i < largest_part.size(); ++i)
+        {
+            largest_part[i] += other.largest_part[i];
+            part_count[i] += other.part_count[i];
+        }
+        invalid += other.invalid;
+    }
+};
+
+
+//chi-square of observed counts against an exact law, with neighbouring values merged into bins expected to hold at least 50 samples
+static void binnedChiSquare(const std::vector<long long>& observed, const std::vector<double>& law, long long samples, double& statistic, int& degrees_of_freedom) {
+    const double least_expected = 50.0;
+    statistic = 0.0;
+    int bins = 0;
+    double bin_expected = 0.0, bin_observed = 0.0;
+    for (size_t m = 0; m < law.size(); ++m)
+    {
+        bin_expected += law[m]*samples;
+        bin_observed += observed[m];
+        if (bin_expected >= least_expected)
+        {
+            statistic += (bin_observed - bin_expected)*(bin_observed - bin_expected)/bin_expected;
+            ++bins;
+            bin_expected = bin_observed = 0.0;
+        }
+    }
+    //the tail that did not fill a bin of its own
+    if (bin_expected > 0.0 || bin_observed > 0.0)
+    {
+        statistic += (bin_observed - bin_expected)*(bin_observed - bin_expected)/std::max(bin_expected, 1e-300);
+        ++bins;
+    }
+    degrees_of_freedom = std::max(1, bins - 1);
+}
+
+
+static void moderateTests(const SamplerConfig& config, int n, long long samples, unsigned long long seed, int threads, std::vector<TestResult>& results) {
+    PartStatisticsCounter empty;
+    empty.n = n;
+    empty.part_class = config.part_class;
+    empty.largest_part.assign(n + 1, 0);
+    empty.part_count.assign(n + 1, 0);
+    empty.invalid = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    PartStatisticsCounter counter = sampleInParallel(config, n, samples, empty, seed, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<double> law = largestPartLaw(n, config.part_class);
+
+    TestResult result;
+    result.config = config.name;
+    result.n = n;
+    result.samples = samples;
+    result.invalid = counter.invalid;
+    result.seconds = seconds;
+    int degrees_of_freedom;
+
+    result.test = "largest part";
+    binnedChiSquare(counter.largest_part, law, samples, result.statistic, degrees_of_freedom);
+    result.p_value = chiSquarePValue(result.statistic, degrees_of_freedom);
+    results.push_back(result);
+
+    //conjugation swaps the largest part and the number of parts of unrestricted partitions, so they share one law
+    if (config.part_class == all_parts)
+    {
+        result.test = "part count";
+        binnedChiSquare(counter.part_count, law, samples, result.statistic, degrees_of_freedom);
+        result.p_value = chiSquarePValue(result.statistic, degrees_of_freedom);
+        result.seconds = 0.0;
+        results.push_back(result);
+
+        //the same laws through generateStatistics(), which reduces on the worker threads and keeps no sample
+        if (!config.sweep && !config.odd_distinct)
+        {
+            PartitionCreator creator;
+            creator.seed(seed + 1);
+            creator.setStorage(config.storage);
+            creator.setSkipSampling(config.skip_sampling);
+            PartitionStatistics statistics;
+            start = std::chrono::steady_clock::now();
+            creator.generateStatistics(statistics, n, samples, config.algorithm, threads);
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.invalid = 0;
+
+            const std::vector<unsigned long long>& counts = statistics.largestPartCounts();
+            std::vector<long long> observed(n + 1, 0);
+            for (size_t m = 0; m < counts.size() && m < observed.size(); ++m)
+                observed[m] = counts[m];
+            result.test = "streamed largest";
+            binnedChiSquare(observed, law, samples, result.statistic, degrees_of_freedom);
+            result.p_value = chiSquarePValue(result.statistic, degrees_of_freedom);
+            results.push_back(result);
+
+            //z-score of the mean number of parts, whose exact value is the mean largest part
+            double exact_mean = 0.0;
+            for (int m = 1; m <= n; ++m)
+                exact_mean += m*law[m];
+            result.test = "streamed parts";
+            result.statistic = (statistics.meanParts() - exact_mean)/sqrt(statistics.partsVariance()/samples);
+            result.p_value = erfc(fabs(result.statistic)/sqrt(2.0));
+            result.seconds = 0.0;
+            results.push_back(result);
+        }
+    }
+}
+
+
+//largest part and number of parts of every sample, scaled so that they tend to the standard Gumbel law
+struct GumbelCollector {
+    int n;
+    partClasses part_class;
+    //scale t of the class at n: parts in the class have density density among the integers, and a class
+    //partition with largest part L has t*L - log(density/t) close to Gumbel
+    double t;
+    double density;
+    std::vector<double> largest_part;
+    std::vector<double> part_count;
+    long long invalid;
+
+    void add(const RandomPartition& partition) {
+        if (!belongsToClass(partition, n, part_class))
+        {
+            ++invalid;
+            return;
+        }
+        int largest = 0;
+        long long parts = 0;
+        forEachPart(partition, [&](int part, int multiplicity) {
+            largest = part;
+            parts += multiplicity;
+        });
+        largest_part.push_back(t*largest - log(density/t));
+        part_count.push_back(t*parts - log(density/t));
+    }
+
+    void merge(const GumbelCollector& other) {
+        largest_part.insert(largest_part.end(), other.largest_part.begin(), other.largest_part.end());
+        part_count.insert(part_count.end(), other.part_count.begin(), other.part_count.end());
+        invalid += other.invalid;
+    }
+};
+
+
+//Kolmogorov-Smirnov distance between the empirical law of values and the standard Gumbel law
+static double gumbelDistance(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    double distance = 0.0;
+    double count = values.size();
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        double expected = exp(-exp(-values[i]));
+        distance = std::max(distance, std::max(fabs(expected - i/count), fabs(expected - (i + 1)/count)));
+    }
+    return distance;
+}
+
+
+static void largeTests(const SamplerConfig& config, int n, long long samples, unsigned long long seed, int threads, std::vector<TestResult>& results) {
+    const double pi = 3.14159265358979323846;
+    GumbelCollector empty;
+    empty.n = n;
+    empty.part_class = config.part_class;
+    empty.density = (config.part_class == all_parts || config.part_class == distinct_parts) ? 1.0 : 0.5;
+    //the Boltzmann parameter x = e^-t that makes the expected size n
+    if (isDistinct(config.part_class))
+        empty.t = pi*sqrt(empty.density/(12.0*n));
+    else
+        empty.t = pi*sqrt(empty.density/(6.0*n));
+    empty.invalid = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GumbelCollector collector = sampleInParallel(config, n, samples, empty, seed, threads);
+
+    TestResult result;
+    result.config = config.name;
+    result.n = n;
+    result.samples = samples;
+    result.invalid = collector.invalid;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.test = "largest part";
+    result.statistic = gumbelDistance(collector.largest_part);
+    result.p_value = kolmogorovPValue(result.statistic, collector.largest_part.size());
+    results.push_back(result);
+
+    //only unrestricted partitions have a Gumbel number of parts, the same as their largest part
+    if (config.part_class == all_parts)
+    {
+        result.test = "part count";
+        result.statistic = gumbelDistance(collector.part_count);
+        result.p_value = kolmogorovPValue(result.statistic, collector.part_count.size());
+        result.seconds = 0.0;
+        results.push_back(result);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    double scale = 1.0;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned long long seed = 20160105;
+    double alpha = 1e-4;
+    std::string only;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--quick")
+            scale = 0.1;
+        else if (argument == "--scale" && i + 1 < argc)
+            scale = atof(argv[++i]);
+        else if (argument == "--threads" && i + 1 < argc)
+            threads = std::max(1, atoi(argv[++i]));
+        else if (argument == "--seed" && i + 1 < argc)
+            seed = strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--alpha" && i + 1 < argc)
+            alpha = atof(argv[++i]);
+        else if (argument == "--only" && i + 1 < argc)
+            only = argv[++i];
+        else
+        {
+            std::cout << "usage: " << argv[0] << " [--quick] [--scale factor] [--threads count] [--seed value] [--alpha level] [--only name]" << std::endl;
+            return 2;
+        }
+    }
+    long long small_samples = std::max(1000LL, (long long)(1000000*scale));
+    long long moderate_samples = std::max(1000LL, (long long)(100000*scale));
+    long long large_samples = std::max(1000LL, (long long)(20000*scale));
+
+    std::cout << "sampler validation, " << threads << " threads, seed " << seed << ", alpha " << alpha << std::endl;
+    std::cout << "  " << std::left << std::setw(32) << "sampler" << std::setw(16) << "test" << std::right << std::setw(9) << "n"
+        << std::setw(10) << "samples" << std::setw(12) << "statistic" << std::setw(12) << "p-value" << std::setw(10) << "time" << std::endl;
+
+    int failures = 0;
+    for (size_t c = 0; c < sizeof(sampler_configs)/sizeof(sampler_configs[0]); ++c)
+    {
+        const SamplerConfig& config = sampler_configs[c];
+        if (!only.empty() && only != config.name)
+            continue;
+
+        //every test gets its own seed, so adding tests does not change the samples of the others
+        for (size_t s = 0; s < sizeof(small_sizes)/sizeof(small_sizes[0]); ++s)
+            failures += !printResult(smallTest(config, small_sizes[s], small_samples, testSeed(seed, config.name, "small", small_sizes[s]), threads), alpha);
+
+        std::vector<TestResult> results;
+        if (config.largest_scale >= 1)
+            moderateTests(config, moderate_size, moderate_samples, testSeed(seed, config.name, "moderate", moderate_size), threads, results);
+        if (config.largest_scale >= 2)
+            largeTests(config, large_size, large_samples, testSeed(seed, config.name, "large", large_size), threads, results);
+        for (size_t r = 0; r < results.size(); ++r)
+            failures += !printResult(results[r], alpha);
+    }
+
+    if (failures == 0)
+        std::cout << "all tests passed" << std::endl;
+    else
+        std::cout << "FAILED: " << failures << " test(s)" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
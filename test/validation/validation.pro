@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Statistical validation of the partition samplers
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = validation
+TEMPLATE = app
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += validation.cpp \
+    ../PartitionCreator.cpp \
+    ../MultiplicityKernel.cpp \
+    ../PartitionCountTable.cpp \
+    ../PartitionStatistics.cpp
+
+HEADERS  += \
+    ../PartitionCreator.h \
+    ../RestrictionPolicy.h \
+    ../MultiplicityKernel.h \
+    ../PartitionCountTable.h \
+    ../PartitionStatistics.h